@@ -1,7 +1,9 @@
 #ifndef AWAITABLE_HPP
 #define AWAITABLE_HPP
 
+#include <concepts>
 #include <coroutine>
+#include <utility>
 
 namespace libcoro {
 namespace concepts {
@@ -10,9 +12,9 @@ template <typename type, typename... types>
 concept in_types = (std::same_as<type, types> || ...);
 
 template <typename type>
-concept awaiter = requires(type a) {
+concept awaiter = requires(type a, std::coroutine_handle<> handle) {
   { a.await_ready() } -> std::same_as<bool>;
-  { a.await_suspend() } -> in_types<void, bool, std::coroutine_handle<>>;
+  { a.await_suspend(handle) } -> in_types<void, bool, std::coroutine_handle<>>;
   { a.await_resume() };
 };
 
@@ -4,6 +4,7 @@
 #include "concepts/awaitable.hpp"
 #include <concepts>
 #include <coroutine>
+#include <span>
 
 namespace libcoro {
 namespace concepts {
@@ -13,6 +14,13 @@ concept executor = requires(type a, std::coroutine_handle<> handle) {
   { a.resume(handle) } -> std::same_as<void>;
   { a.shutdown() } -> std::same_as<void>;
 };
+
+// executors that can take a whole batch of handles with one lock and one round of wake ups.
+template <typename type>
+concept batch_executor =
+    executor<type> && requires(type a, std::span<std::coroutine_handle<>> handles) {
+      { a.resume_batch(handles) } -> std::same_as<void>;
+    };
 }
 } // namespace libcoro
 
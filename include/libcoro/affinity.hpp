@@ -0,0 +1,16 @@
+#ifndef AFFINITY_HPP
+#define AFFINITY_HPP
+
+#include <cstddef>
+#include <thread>
+
+namespace libcoro {
+namespace detail {
+// pin a thread to a single cpu, cpu indices wrap around the number of online cpus.
+// returns false when the platform does not support it or the call failed.
+bool pin_thread(std::thread& thread, std::size_t cpu) noexcept;
+std::size_t cpu_count() noexcept;
+} // namespace detail
+} // namespace libcoro
+
+#endif // !AFFINITY_HPP
@@ -0,0 +1,224 @@
+#ifndef APPEND_LOG_HPP
+#define APPEND_LOG_HPP
+
+#include "concepts/executor.hpp"
+#include "libcoro/file.hpp"
+#include "libcoro/io_service.hpp"
+#include "libcoro/task.hpp"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace libcoro {
+namespace detail {
+// writes all of `iovecs` at `offset` and makes it durable with fdatasync. 0 on success, -1 with
+// errno set otherwise. `iovecs` is consumed on partial writes.
+int write_durably(int fd, std::span<struct ::iovec> iovecs, ::off_t offset) noexcept;
+} // namespace detail
+
+struct AppendLogOptions {
+  // upper bounds for one batch, whatever is left waits for the next one.
+  std::size_t max_batch_appends{1024};
+  std::size_t max_batch_bytes{1024 * 1024};
+  // how long an append arriving at an idle log waits for company before the batch is written.
+  // zero writes right away and relies on the appends queueing up behind a running sync.
+  std::chrono::steady_clock::duration max_delay{std::chrono::steady_clock::duration::zero()};
+};
+
+// Group commit on top of a File: concurrent appends are gathered into batches, each written with
+// one pwritev and made durable with one fdatasync, and every append of a batch is resumed once
+// the batch is on disk. With many writers the sync cost is shared instead of paid per record.
+//
+// Records are appended at the end of the file in the order they were submitted. After a failed
+// write the log is in an unknown state and every later append fails as well. The log must
+// outlive the appends in flight.
+template <concepts::executor Executor>
+class AppendLog {
+  using io_service_ptr = std::shared_ptr<IOService<Executor>>;
+
+public:
+  class AppendAwaiter {
+  public:
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle);
+    // where the record starts in the file, -1 when it could not be made durable.
+    ::off_t await_resume() const noexcept { return _offset; }
+
+  private:
+    friend class AppendLog;
+    AppendAwaiter(AppendLog& log, std::span<const char> record) noexcept
+        : _log(log), _record(record) {}
+
+    AppendLog& _log;
+    std::span<const char> _record;
+    std::coroutine_handle<> _handle{nullptr};
+    ::off_t _offset{-1};
+    AppendAwaiter* _next{nullptr};
+  };
+
+  AppendLog(io_service_ptr io_service, File<Executor>&& file, AppendLogOptions options = {});
+
+  AppendLog(const AppendLog&) = delete;
+  AppendLog& operator=(const AppendLog&) = delete;
+  AppendLog(AppendLog&&) = delete;
+  AppendLog& operator=(AppendLog&&) = delete;
+
+  // `record` must stay valid until the append completes.
+  AppendAwaiter append(std::span<const char> record) noexcept { return {*this, record}; }
+
+  // batches written so far, i.e. fdatasync calls.
+  std::size_t batches() const noexcept { return _batches.load(std::memory_order_relaxed); }
+
+private:
+  // runs on the executor while there are appends, one at a time.
+  Task<> flush_loop();
+  // with _mutex held.
+  bool batch_full() const noexcept {
+    return _pending_appends >= _options.max_batch_appends ||
+           _pending_bytes >= _options.max_batch_bytes;
+  }
+
+  io_service_ptr _io_service;
+  File<Executor> _file;
+  AppendLogOptions _options;
+  // only touched by the flush loop.
+  ::off_t _end{0};
+
+  std::mutex _mutex{};
+  AppendAwaiter* _head{nullptr};
+  AppendAwaiter* _tail{nullptr};
+  std::size_t _pending_appends{0};
+  std::size_t _pending_bytes{0};
+  bool _flushing{false};
+  bool _failed{false};
+
+  std::atomic<std::size_t> _batches{0};
+};
+
+template <concepts::executor Executor>
+AppendLog<Executor>::AppendLog(io_service_ptr io_service, File<Executor>&& file,
+                               AppendLogOptions options)
+    : _io_service(std::move(io_service)), _file(std::move(file)), _options(options) {
+  if (_file.fd() == -1) {
+    throw std::runtime_error("File descriptor is null");
+  }
+  _end = ::lseek(_file.fd(), 0, SEEK_END);
+  if (_end == -1) {
+    throw std::runtime_error("Failed to seek file");
+  }
+}
+
+template <concepts::executor Executor>
+bool AppendLog<Executor>::AppendAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  // once queued, the awaiter may be resumed and gone before this returns.
+  auto& log = _log;
+  bool start = false;
+  {
+    std::scoped_lock lock(log._mutex);
+    if (log._failed) {
+      return false;
+    }
+    _handle = handle;
+    if (log._tail != nullptr) {
+      log._tail->_next = this;
+    } else {
+      log._head = this;
+    }
+    log._tail = this;
+    ++log._pending_appends;
+    log._pending_bytes += _record.size();
+    start = !std::exchange(log._flushing, true);
+  }
+  if (start) {
+    log._io_service->execute(log.flush_loop());
+  }
+  return true;
+}
+
+template <concepts::executor Executor>
+Task<> AppendLog<Executor>::flush_loop() {
+  if (_options.max_delay > std::chrono::steady_clock::duration::zero()) {
+    bool full = false;
+    {
+      std::scoped_lock lock(_mutex);
+      full = batch_full();
+    }
+    if (!full) {
+      co_await _io_service->sleep_for(_options.max_delay);
+    }
+  }
+
+  std::vector<struct ::iovec> iovecs;
+  while (true) {
+    AppendAwaiter* batch = nullptr;
+    bool failed = false;
+    std::size_t bytes = 0;
+    iovecs.clear();
+    {
+      std::scoped_lock lock(_mutex);
+      if (_head == nullptr) {
+        _flushing = false;
+        co_return;
+      }
+      failed = _failed;
+
+      // at least one append, however large.
+      batch = _head;
+      auto* last = _head;
+      while (true) {
+        iovecs.push_back({const_cast<char*>(last->_record.data()), last->_record.size()});
+        bytes += last->_record.size();
+        auto* next = last->_next;
+        if (next == nullptr || iovecs.size() == _options.max_batch_appends ||
+            bytes + next->_record.size() > _options.max_batch_bytes) {
+          break;
+        }
+        last = next;
+      }
+      _head = last->_next;
+      if (_head == nullptr) {
+        _tail = nullptr;
+      }
+      last->_next = nullptr;
+      _pending_appends -= iovecs.size();
+      _pending_bytes -= bytes;
+    }
+
+    auto offset = _end;
+    if (!failed) {
+      auto result = co_await _io_service->offload([fd = _file.fd(), &iovecs, offset]() {
+        return detail::write_durably(fd, iovecs, offset);
+      });
+      _batches.fetch_add(1, std::memory_order_relaxed);
+      if (result == -1) {
+        failed = true;
+        std::scoped_lock lock(_mutex);
+        _failed = true;
+      } else {
+        _end += static_cast<::off_t>(bytes);
+      }
+    }
+
+    // like Event, the appenders run on this thread before the next batch is taken.
+    for (auto* append = batch; append != nullptr;) {
+      auto* next = append->_next;
+      append->_offset = failed ? -1 : offset;
+      offset += static_cast<::off_t>(append->_record.size());
+      append->_handle.resume();
+      append = next;
+    }
+  }
+}
+} // namespace libcoro
+
+#endif // !APPEND_LOG_HPP
@@ -0,0 +1,130 @@
+#ifndef ASYNC_GENERATOR_HPP
+#define ASYNC_GENERATOR_HPP
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace libcoro {
+template <typename T>
+class AsyncGenerator;
+
+namespace detail {
+// Unlike Generator the body may co_await, so values are pulled with `co_await generator.next()`
+// rather than iterated. Producer and consumer hand control to each other by symmetric transfer,
+// no executor hop happens between two items.
+template <typename T>
+class AsyncGeneratorPromise {
+  struct TransferAwaiter {
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<>) noexcept { return _consumer; }
+    void await_resume() noexcept {}
+
+    std::coroutine_handle<> _consumer;
+  };
+
+public:
+  AsyncGeneratorPromise() = default;
+
+  AsyncGenerator<T> get_return_object() noexcept;
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  TransferAwaiter final_suspend() noexcept { return {_consumer}; }
+
+  TransferAwaiter yield_value(T&& value) noexcept {
+    _value = std::addressof(value);
+    return {_consumer};
+  }
+
+  void unhandled_exception() noexcept { _exception = std::current_exception(); }
+  void return_void() noexcept {}
+
+  void set_consumer(std::coroutine_handle<> consumer) noexcept { _consumer = consumer; }
+  // only valid between a yield and the next resumption.
+  T& value() const noexcept { return *_value; }
+
+  void rethrow_exception() {
+    if (_exception) {
+      std::rethrow_exception(std::exchange(_exception, nullptr));
+    }
+  }
+
+private:
+  T* _value{nullptr};
+  std::coroutine_handle<> _consumer{nullptr};
+  std::exception_ptr _exception{nullptr};
+};
+} // namespace detail
+
+template <typename T>
+class [[nodiscard]] AsyncGenerator {
+  static_assert(!std::is_reference_v<T>, "AsyncGenerator yields values");
+
+public:
+  using promise_type = detail::AsyncGeneratorPromise<T>;
+  using coroutine_handle_type = std::coroutine_handle<promise_type>;
+
+  struct NextAwaiter {
+    bool await_ready() const noexcept { return !_coroutine || _coroutine.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> consumer) noexcept {
+      _coroutine.promise().set_consumer(consumer);
+      return _coroutine;
+    }
+    // the next value, nullopt once the generator has finished.
+    std::optional<T> await_resume() {
+      if (!_coroutine) {
+        return std::nullopt;
+      }
+      if (_coroutine.done()) {
+        _coroutine.promise().rethrow_exception();
+        return std::nullopt;
+      }
+      return std::optional<T>(std::move(_coroutine.promise().value()));
+    }
+
+    coroutine_handle_type _coroutine;
+  };
+
+  AsyncGenerator() noexcept = default;
+  explicit AsyncGenerator(coroutine_handle_type coroutine) noexcept: _coroutine(coroutine) {}
+
+  AsyncGenerator(const AsyncGenerator&) = delete;
+  AsyncGenerator& operator=(const AsyncGenerator&) = delete;
+
+  AsyncGenerator(AsyncGenerator&& other) noexcept
+      : _coroutine(std::exchange(other._coroutine, nullptr)) {}
+  AsyncGenerator& operator=(AsyncGenerator&& other) noexcept {
+    if (this != std::addressof(other)) {
+      if (_coroutine) {
+        _coroutine.destroy();
+      }
+      _coroutine = std::exchange(other._coroutine, nullptr);
+    }
+    return *this;
+  }
+
+  // must not be destroyed while a next() is in flight.
+  ~AsyncGenerator() {
+    if (_coroutine) {
+      _coroutine.destroy();
+    }
+  }
+
+  NextAwaiter next() noexcept { return NextAwaiter{_coroutine}; }
+
+private:
+  coroutine_handle_type _coroutine{nullptr};
+};
+
+namespace detail {
+template <typename T>
+AsyncGenerator<T> AsyncGeneratorPromise<T>::get_return_object() noexcept {
+  return AsyncGenerator<T>{std::coroutine_handle<AsyncGeneratorPromise>::from_promise(*this)};
+}
+} // namespace detail
+} // namespace libcoro
+
+#endif // !ASYNC_GENERATOR_HPP
@@ -0,0 +1,72 @@
+#ifndef BLOCKING_POOL_HPP
+#define BLOCKING_POOL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libcoro {
+namespace detail {
+// Intrusive unit of work, usually an awaiter living in the frame of the coroutine waiting for it.
+struct BlockingJob {
+  void (*run)(BlockingJob*) noexcept{nullptr};
+  BlockingJob* next{nullptr};
+};
+
+// Threads for calls that block in the kernel (disk reads, fsync, getaddrinfo), so they never run
+// on an executor or the io thread. Elastic: a thread is started whenever a job finds no idle one
+// that an earlier queued job has not claimed, up to max_threads, after which jobs queue up in
+// submission order. Threads that stay idle for
+// idle_timeout exit again, so a spike does not leave its threads behind.
+class BlockingPool {
+public:
+  static constexpr std::size_t DEFAULT_MAX_THREADS = 64;
+  static constexpr std::chrono::seconds DEFAULT_IDLE_TIMEOUT{10};
+
+  explicit BlockingPool(std::size_t max_threads = DEFAULT_MAX_THREADS,
+                        std::chrono::milliseconds idle_timeout = DEFAULT_IDLE_TIMEOUT) noexcept
+      : _max_threads(max_threads), _idle_timeout(idle_timeout) {}
+  ~BlockingPool() { shutdown(); }
+
+  BlockingPool(const BlockingPool&) = delete;
+  BlockingPool& operator=(const BlockingPool&) = delete;
+  BlockingPool(BlockingPool&&) = delete;
+  BlockingPool& operator=(BlockingPool&&) = delete;
+
+  void submit(BlockingJob& job);
+  // runs what was submitted already, then joins the threads. later jobs run inline.
+  void shutdown();
+
+  // threads beyond a lowered limit exit once they are idle.
+  void set_max_threads(std::size_t max_threads);
+  std::size_t threads() const;
+
+private:
+  using thread_list = std::list<std::thread>;
+
+  void worker_function(thread_list::iterator self);
+  // joins threads that exited on their own, without holding the lock.
+  void join_exited();
+
+  std::size_t _max_threads;
+  std::chrono::milliseconds _idle_timeout;
+
+  mutable std::mutex _mutex{};
+  std::condition_variable _cv{};
+  BlockingJob* _head{nullptr};
+  BlockingJob* _tail{nullptr};
+  // jobs submitted but not taken by a thread yet.
+  std::size_t _queued{0};
+  std::size_t _idle{0};
+  bool _stopping{false};
+  thread_list _threads{};
+  std::vector<std::thread> _exited{};
+};
+} // namespace detail
+} // namespace libcoro
+
+#endif // !BLOCKING_POOL_HPP
@@ -0,0 +1,96 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace libcoro {
+namespace detail {
+class BufferPool;
+} // namespace detail
+
+// Move-only handle on a pooled buffer, the buffer goes back to its pool when the lease dies.
+// Leases must not outlive the pool (the IOService) they came from.
+class BufferLease {
+public:
+  BufferLease() noexcept = default;
+  ~BufferLease() { release(); }
+
+  BufferLease(const BufferLease&) = delete;
+  BufferLease& operator=(const BufferLease&) = delete;
+
+  BufferLease(BufferLease&& other) noexcept;
+  BufferLease& operator=(BufferLease&& other) noexcept;
+
+  char* data() const noexcept { return _data; }
+  // the part of the buffer in use, `resize` moves its end within the capacity.
+  std::size_t size() const noexcept { return _size; }
+  std::size_t capacity() const noexcept { return _capacity; }
+  std::span<char> span() const noexcept { return {_data, _size}; }
+  void resize(std::size_t size) noexcept { _size = size < _capacity ? size : _capacity; }
+
+  explicit operator bool() const noexcept { return _data != nullptr; }
+
+private:
+  friend class detail::BufferPool;
+  BufferLease(detail::BufferPool* pool, char* data, std::size_t size, std::size_t capacity,
+              std::size_t size_class) noexcept
+      : _pool(pool), _data(data), _size(size), _capacity(capacity), _size_class(size_class) {}
+
+  void release() noexcept;
+
+  detail::BufferPool* _pool{nullptr};
+  char* _data{nullptr};
+  std::size_t _size{0};
+  std::size_t _capacity{0};
+  std::size_t _size_class{0};
+};
+
+namespace detail {
+// Power-of-two size classes from 256 bytes to 64 KiB, each keeping a small LIFO of free
+// buffers so the most recently returned, still cache-warm, buffer is handed out first. Larger
+// requests are served straight from the heap and freed on release.
+class BufferPool {
+public:
+  static constexpr std::size_t MIN_BUFFER_SIZE = 256;
+  static constexpr std::size_t MAX_BUFFER_SIZE = 64 * 1024;
+  static constexpr std::size_t SIZE_CLASSES = 9;
+  // free buffers kept per class, the rest is returned to the heap.
+  static constexpr std::size_t MAX_CACHED = 64;
+
+  BufferPool();
+  ~BufferPool();
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+  BufferPool(BufferPool&&) = delete;
+  BufferPool& operator=(BufferPool&&) = delete;
+
+  BufferLease acquire(std::size_t size);
+
+private:
+  friend class libcoro::BufferLease;
+
+  struct SizeClass {
+    std::mutex mutex{};
+    std::vector<char*> free{};
+  };
+
+  static std::size_t size_class(std::size_t size) noexcept;
+  static std::size_t class_size(std::size_t size_class) noexcept {
+    return MIN_BUFFER_SIZE << size_class;
+  }
+  static char* allocate(std::size_t size);
+  static void deallocate(char* data) noexcept;
+
+  void release(char* data, std::size_t size_class) noexcept;
+
+  std::array<SizeClass, SIZE_CLASSES> _classes{};
+};
+} // namespace detail
+} // namespace libcoro
+
+#endif // !BUFFER_POOL_HPP
@@ -0,0 +1,254 @@
+#ifndef BUFFERED_STREAM_HPP
+#define BUFFERED_STREAM_HPP
+
+#include "libcoro/byte_search.hpp"
+#include "libcoro/file.hpp"
+#include "libcoro/socket.hpp"
+#include "libcoro/task.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace libcoro {
+namespace detail {
+// the one read and write primitive the buffered adapters need from a stream.
+template <concepts::executor Executor>
+Task<std::pair<socket::TransferStatus, std::size_t>> read_some(Socket<Executor>& socket,
+                                                               std::span<char> buffer) {
+  return socket.recieve(buffer);
+}
+
+template <concepts::executor Executor>
+Task<std::pair<socket::TransferStatus, std::size_t>> read_some(File<Executor>& file,
+                                                               std::span<char> buffer) {
+  auto bytes = co_await file.read(buffer);
+  if (bytes < 0) {
+    co_return {static_cast<socket::TransferStatus>(-bytes), 0};
+  }
+  co_return {bytes == 0 ? socket::TransferStatus::CLOSED : socket::TransferStatus::OK,
+             static_cast<std::size_t>(bytes)};
+}
+
+template <concepts::executor Executor>
+Task<socket::TransferStatus> write_all(Socket<Executor>& socket, std::span<const char> data) {
+  auto [status, sent] = co_await socket.send_all(data);
+  co_return status;
+}
+
+template <concepts::executor Executor>
+Task<socket::TransferStatus> write_all(File<Executor>& file, std::span<const char> data) {
+  while (!data.empty()) {
+    auto written = co_await file.write(data);
+    if (written < 0) {
+      co_return static_cast<socket::TransferStatus>(-written);
+    }
+    if (written == 0) {
+      co_return socket::TransferStatus::CLOSED;
+    }
+    data = data.subspan(static_cast<std::size_t>(written));
+  }
+  co_return socket::TransferStatus::OK;
+}
+} // namespace detail
+
+// Reads a Socket or File through a fixed buffer. Unread bytes are moved back to the front when
+// the buffer runs full rather than wrapping around, so the buffered data is always contiguous:
+// delimiters are found with one vector scan and lines come back as views, without copying.
+template <typename Stream>
+class BufferedReader {
+public:
+  static constexpr std::size_t DEFAULT_CAPACITY = 16 * 1024;
+
+  explicit BufferedReader(Stream& stream, std::size_t capacity = DEFAULT_CAPACITY)
+      : _stream(stream), _buffer(std::make_unique<char[]>(capacity)), _capacity(capacity) {}
+
+  BufferedReader(const BufferedReader&) = delete;
+  BufferedReader& operator=(const BufferedReader&) = delete;
+  BufferedReader(BufferedReader&&) noexcept = default;
+  BufferedReader& operator=(BufferedReader&&) = delete;
+
+  // fills all of `buffer`, CLOSED when the stream ends first.
+  Task<socket::TransferStatus> read_exact(std::span<char> buffer);
+
+  // the data up to and including `delimiter`. the view stays valid until the next read.
+  // MESSAGE_SIZE when the delimiter does not show up within the buffer's capacity. when the
+  // stream ends, what is left without a delimiter comes back as OK, and the next call is CLOSED.
+  Task<std::pair<socket::TransferStatus, std::string_view>> read_until(std::string_view delimiter);
+
+  // the next line without its "\n" or "\r\n". the last one may have neither.
+  Task<std::pair<socket::TransferStatus, std::string_view>> read_line();
+
+  std::size_t buffered() const noexcept { return _end - _begin; }
+
+private:
+  // reads more data behind what is buffered, MESSAGE_SIZE when there is no room left.
+  Task<socket::TransferStatus> fill();
+
+  std::string_view buffered_view() const noexcept {
+    return std::string_view(_buffer.get() + _begin, _end - _begin);
+  }
+
+  Stream& _stream;
+  std::unique_ptr<char[]> _buffer;
+  std::size_t _capacity;
+  std::size_t _begin{0};
+  std::size_t _end{0};
+};
+
+// Coalesces small writes into one buffer and hands it to the stream in a single call when it
+// runs full or on flush(). Writes at least as large as the buffer go straight through. Call
+// flush() once per turn, e.g. after answering everything a read produced, and before the writer
+// goes away.
+template <typename Stream>
+class BufferedWriter {
+public:
+  static constexpr std::size_t DEFAULT_CAPACITY = 16 * 1024;
+
+  explicit BufferedWriter(Stream& stream, std::size_t capacity = DEFAULT_CAPACITY)
+      : _stream(stream), _buffer(std::make_unique<char[]>(capacity)), _capacity(capacity) {}
+
+  BufferedWriter(const BufferedWriter&) = delete;
+  BufferedWriter& operator=(const BufferedWriter&) = delete;
+  BufferedWriter(BufferedWriter&&) noexcept = default;
+  BufferedWriter& operator=(BufferedWriter&&) = delete;
+
+  Task<socket::TransferStatus> write(std::span<const char> data);
+  Task<socket::TransferStatus> flush();
+
+  std::size_t buffered() const noexcept { return _size; }
+
+private:
+  Stream& _stream;
+  std::unique_ptr<char[]> _buffer;
+  std::size_t _capacity;
+  std::size_t _size{0};
+};
+
+template <typename Stream>
+Task<socket::TransferStatus> BufferedReader<Stream>::fill() {
+  if (_end == _capacity) {
+    if (_begin == 0) {
+      co_return socket::TransferStatus::MESSAGE_SIZE;
+    }
+    std::memmove(_buffer.get(), _buffer.get() + _begin, _end - _begin);
+    _end -= _begin;
+    _begin = 0;
+  }
+
+  auto [status, bytes] =
+      co_await detail::read_some(_stream, std::span<char>(_buffer.get() + _end, _capacity - _end));
+  if (status == socket::TransferStatus::OK) {
+    _end += bytes;
+  }
+  co_return status;
+}
+
+template <typename Stream>
+Task<socket::TransferStatus> BufferedReader<Stream>::read_exact(std::span<char> buffer) {
+  auto copied = std::min(buffer.size(), buffered());
+  std::memcpy(buffer.data(), _buffer.get() + _begin, copied);
+  _begin += copied;
+  buffer = buffer.subspan(copied);
+
+  while (!buffer.empty()) {
+    if (buffer.size() >= _capacity) {
+      // too large to stage, read straight into the destination.
+      auto [status, bytes] = co_await detail::read_some(_stream, buffer);
+      if (status != socket::TransferStatus::OK) {
+        co_return status;
+      }
+      buffer = buffer.subspan(bytes);
+      continue;
+    }
+
+    _begin = 0;
+    _end = 0;
+    if (auto status = co_await fill(); status != socket::TransferStatus::OK) {
+      co_return status;
+    }
+    copied = std::min(buffer.size(), buffered());
+    std::memcpy(buffer.data(), _buffer.get() + _begin, copied);
+    _begin += copied;
+    buffer = buffer.subspan(copied);
+  }
+
+  co_return socket::TransferStatus::OK;
+}
+
+template <typename Stream>
+Task<std::pair<socket::TransferStatus, std::string_view>>
+BufferedReader<Stream>::read_until(std::string_view delimiter) {
+  // bytes already known not to start a match, so every byte is scanned only once.
+  std::size_t scanned = 0;
+  while (true) {
+    auto found = detail::find_delimiter(buffered_view().substr(scanned), delimiter);
+    if (found != std::string_view::npos) {
+      auto length = scanned + found + delimiter.size();
+      auto line = buffered_view().substr(0, length);
+      _begin += length;
+      co_return {socket::TransferStatus::OK, line};
+    }
+    if (buffered() >= delimiter.size()) {
+      scanned = buffered() - delimiter.size() + 1;
+    }
+
+    if (auto status = co_await fill(); status != socket::TransferStatus::OK) {
+      if (status == socket::TransferStatus::CLOSED && buffered() > 0) {
+        auto rest = buffered_view();
+        _begin = _end;
+        co_return {socket::TransferStatus::OK, rest};
+      }
+      co_return {status, std::string_view()};
+    }
+  }
+}
+
+template <typename Stream>
+Task<std::pair<socket::TransferStatus, std::string_view>> BufferedReader<Stream>::read_line() {
+  auto [status, line] = co_await read_until("\n");
+  if (status != socket::TransferStatus::OK) {
+    co_return {status, line};
+  }
+  if (line.empty() || line.back() != '\n') {
+    // the stream ended without one.
+    co_return {status, line};
+  }
+  line.remove_suffix(1);
+  if (!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+  co_return {status, line};
+}
+
+template <typename Stream>
+Task<socket::TransferStatus> BufferedWriter<Stream>::write(std::span<const char> data) {
+  if (data.size() > _capacity - _size) {
+    if (auto status = co_await flush(); status != socket::TransferStatus::OK) {
+      co_return status;
+    }
+  }
+  if (data.size() >= _capacity) {
+    co_return co_await detail::write_all(_stream, data);
+  }
+
+  std::memcpy(_buffer.get() + _size, data.data(), data.size());
+  _size += data.size();
+  co_return socket::TransferStatus::OK;
+}
+
+template <typename Stream>
+Task<socket::TransferStatus> BufferedWriter<Stream>::flush() {
+  if (_size == 0) {
+    co_return socket::TransferStatus::OK;
+  }
+  auto status = co_await detail::write_all(_stream, std::span<const char>(_buffer.get(), _size));
+  _size = 0;
+  co_return status;
+}
+} // namespace libcoro
+
+#endif // !BUFFERED_STREAM_HPP
@@ -0,0 +1,17 @@
+#ifndef BYTE_SEARCH_HPP
+#define BYTE_SEARCH_HPP
+
+#include <cstddef>
+#include <string_view>
+
+namespace libcoro {
+namespace detail {
+// offset of the first `byte` in `data`, npos when there is none. scans 32 bytes per step with
+// AVX2 when the cpu has it, 16 with SSE2 otherwise, and falls back to memchr off x86.
+std::size_t find_byte(std::string_view data, char byte) noexcept;
+// offset of the first occurrence of `delimiter` in `data`, npos when there is none.
+std::size_t find_delimiter(std::string_view data, std::string_view delimiter) noexcept;
+} // namespace detail
+} // namespace libcoro
+
+#endif // !BYTE_SEARCH_HPP
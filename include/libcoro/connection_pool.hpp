@@ -0,0 +1,333 @@
+#ifndef CONNECTION_POOL_HPP
+#define CONNECTION_POOL_HPP
+
+#include "concepts/executor.hpp"
+#include "libcoro/io_service.hpp"
+#include "libcoro/ip_address.hpp"
+#include "libcoro/socket.hpp"
+#include "libcoro/socket_options.hpp"
+#include "libcoro/task.hpp"
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace libcoro {
+struct ConnectionPoolOptions {
+  // per endpoint, checked out and idle connections together.
+  std::size_t max_connections{16};
+  // idle connections older than this are closed instead of reused.
+  std::chrono::steady_clock::duration idle_timeout{std::chrono::seconds(30)};
+  std::optional<std::chrono::steady_clock::duration> connect_timeout{std::nullopt};
+  // applied to every new connection before it connects.
+  socket::Options socket_options{};
+};
+
+// Keeps outbound TCP connections per address and port open for reuse. Checking out prefers the
+// most recently returned idle connection and checks it is still alive, opens a new one while the
+// endpoint is below max_connections, and waits for a connection to come back otherwise.
+//
+// A pool serves one IOService. With a ShardedRuntime, keep one pool per shard so checkouts never
+// contend across threads. Leases must be returned before the pool goes away.
+template <concepts::executor Executor>
+class ConnectionPool {
+  using io_service_ptr = std::shared_ptr<IOService<Executor>>;
+  using clock = std::chrono::steady_clock;
+
+  struct Waiter;
+  struct Idle {
+    Socket<Executor> socket;
+    clock::time_point since;
+  };
+  struct Endpoint {
+    std::vector<Idle> idle{};
+    std::size_t open{0};
+    // checkouts waiting for a connection, in arrival order.
+    Waiter* head{nullptr};
+    Waiter* tail{nullptr};
+  };
+
+public:
+  // A checked out connection, handed back to the pool when the lease dies.
+  class Lease {
+  public:
+    Lease() noexcept = default;
+    ~Lease() { release(); }
+
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    Lease(Lease&& other) noexcept
+        : _pool(std::exchange(other._pool, nullptr)), _endpoint(other._endpoint),
+          _socket(std::move(other._socket)), _reusable(other._reusable) {
+      other._socket.reset();
+    }
+    Lease& operator=(Lease&& other) noexcept {
+      if (this != &other) {
+        release();
+        _pool = std::exchange(other._pool, nullptr);
+        _endpoint = other._endpoint;
+        _socket = std::move(other._socket);
+        other._socket.reset();
+        _reusable = other._reusable;
+      }
+      return *this;
+    }
+
+    Socket<Executor>& operator*() noexcept { return *_socket; }
+    Socket<Executor>* operator->() noexcept { return &*_socket; }
+    explicit operator bool() const noexcept { return _socket.has_value(); }
+
+    // close the connection instead of returning it, e.g. after a protocol error.
+    void discard() noexcept { _reusable = false; }
+
+  private:
+    friend class ConnectionPool;
+    Lease(ConnectionPool* pool, Endpoint* endpoint, Socket<Executor>&& socket) noexcept
+        : _pool(pool), _endpoint(endpoint), _socket(std::move(socket)) {}
+
+    void release() noexcept;
+
+    ConnectionPool* _pool{nullptr};
+    Endpoint* _endpoint{nullptr};
+    std::optional<Socket<Executor>> _socket{std::nullopt};
+    bool _reusable{true};
+  };
+
+  explicit ConnectionPool(io_service_ptr io_service, ConnectionPoolOptions options = {})
+      : _io_service(std::move(io_service)), _options(std::move(options)) {}
+  ~ConnectionPool();
+
+  ConnectionPool(const ConnectionPool&) = delete;
+  ConnectionPool& operator=(const ConnectionPool&) = delete;
+  ConnectionPool(ConnectionPool&&) = delete;
+  ConnectionPool& operator=(ConnectionPool&&) = delete;
+
+  // the lease is empty unless the status is CONENCTED.
+  Task<std::pair<socket::ConnectStatus, Lease>> checkout(const socket::IPAddress& address,
+                                                         int port);
+
+  // closes idle connections past the idle timeout, returns how many. checkout does the same
+  // lazily for the endpoint it serves.
+  std::size_t evict_idle();
+
+  std::size_t idle() const;
+
+private:
+  // parks a checkout until a connection is returned or a slot frees up.
+  struct Waiter {
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) noexcept;
+    void await_resume() noexcept {}
+
+    ConnectionPool& _pool;
+    Endpoint& _endpoint;
+    std::coroutine_handle<> _handle{nullptr};
+    // set when a returned connection was handed over directly.
+    std::optional<Socket<Executor>> _handed{std::nullopt};
+    Waiter* _next{nullptr};
+  };
+
+  // with _mutex held.
+  Waiter* pop_waiter(Endpoint& endpoint) noexcept;
+  // `socket` is empty when the connection was closed rather than returned.
+  void release(Endpoint& endpoint, std::optional<Socket<Executor>> socket) noexcept;
+
+  io_service_ptr _io_service;
+  ConnectionPoolOptions _options;
+
+  mutable std::mutex _mutex{};
+  // node based, leases and waiters keep pointers to their endpoint.
+  std::map<std::pair<socket::IPAddress, int>, Endpoint> _endpoints{};
+};
+
+template <concepts::executor Executor>
+void ConnectionPool<Executor>::Lease::release() noexcept {
+  if (_pool == nullptr || !_socket) {
+    return;
+  }
+  if (_reusable) {
+    _pool->release(*_endpoint, std::move(_socket));
+  } else {
+    _socket->close();
+    _pool->release(*_endpoint, std::nullopt);
+  }
+  _socket.reset();
+  _pool = nullptr;
+}
+
+template <concepts::executor Executor>
+ConnectionPool<Executor>::~ConnectionPool() {
+  for (auto& [key, endpoint] : _endpoints) {
+    for (auto& idle : endpoint.idle) {
+      idle.socket.close();
+    }
+  }
+}
+
+template <concepts::executor Executor>
+auto ConnectionPool<Executor>::checkout(const socket::IPAddress& address, int port)
+    -> Task<std::pair<socket::ConnectStatus, Lease>> {
+  Endpoint* endpoint = nullptr;
+  {
+    std::scoped_lock lock(_mutex);
+    endpoint = &_endpoints[{address, port}];
+  }
+
+  while (true) {
+    std::optional<Socket<Executor>> reused;
+    std::vector<Socket<Executor>> stale;
+    bool reserved = false;
+    {
+      std::scoped_lock lock(_mutex);
+      auto now = clock::now();
+      // most recently used first, it's the least likely to have been closed by the peer.
+      while (!endpoint->idle.empty() && !reused) {
+        auto idle = std::move(endpoint->idle.back());
+        endpoint->idle.pop_back();
+        if (now - idle.since < _options.idle_timeout && idle.socket.alive()) {
+          reused.emplace(std::move(idle.socket));
+        } else {
+          --endpoint->open;
+          stale.push_back(std::move(idle.socket));
+        }
+      }
+      if (!reused && endpoint->open < _options.max_connections) {
+        ++endpoint->open;
+        reserved = true;
+      }
+    }
+    for (auto& connection : stale) {
+      connection.close();
+    }
+
+    if (reused) {
+      co_return {socket::ConnectStatus::CONENCTED, Lease{this, endpoint, std::move(*reused)}};
+    }
+
+    if (reserved) {
+      std::optional<Socket<Executor>> connection;
+      try {
+        connection.emplace(create_socket(_io_service, address.family(), socket::Protocol::TCP,
+                                         _options.socket_options));
+      } catch (...) {
+        release(*endpoint, std::nullopt);
+        throw;
+      }
+
+      auto status = _options.connect_timeout
+                        ? co_await connection->connect(address, port, *_options.connect_timeout)
+                        : co_await connection->connect(address, port);
+      if (status != socket::ConnectStatus::CONENCTED) {
+        connection->close();
+        release(*endpoint, std::nullopt);
+        co_return {status, Lease{}};
+      }
+      co_return {status, Lease{this, endpoint, std::move(*connection)}};
+    }
+
+    Waiter waiter{*this, *endpoint};
+    co_await waiter;
+    if (waiter._handed) {
+      co_return {socket::ConnectStatus::CONENCTED,
+                 Lease{this, endpoint, std::move(*waiter._handed)}};
+    }
+    // a slot was freed, try again.
+  }
+}
+
+template <concepts::executor Executor>
+std::size_t ConnectionPool<Executor>::evict_idle() {
+  // waiters only exist while an endpoint has no idle connections, nobody needs waking here.
+  std::vector<Socket<Executor>> stale;
+  {
+    std::scoped_lock lock(_mutex);
+    auto now = clock::now();
+    for (auto& [key, endpoint] : _endpoints) {
+      auto kept = std::partition(endpoint.idle.begin(), endpoint.idle.end(), [&](Idle& idle) {
+        return now - idle.since < _options.idle_timeout;
+      });
+      for (auto it = kept; it != endpoint.idle.end(); ++it) {
+        stale.push_back(std::move(it->socket));
+      }
+      endpoint.open -= static_cast<std::size_t>(endpoint.idle.end() - kept);
+      endpoint.idle.erase(kept, endpoint.idle.end());
+    }
+  }
+  for (auto& connection : stale) {
+    connection.close();
+  }
+  return stale.size();
+}
+
+template <concepts::executor Executor>
+std::size_t ConnectionPool<Executor>::idle() const {
+  std::scoped_lock lock(_mutex);
+  std::size_t count = 0;
+  for (auto& [key, endpoint] : _endpoints) {
+    count += endpoint.idle.size();
+  }
+  return count;
+}
+
+template <concepts::executor Executor>
+bool ConnectionPool<Executor>::Waiter::await_suspend(std::coroutine_handle<> handle) noexcept {
+  std::scoped_lock lock(_pool._mutex);
+  // something came back between the failed checkout and now.
+  if (!_endpoint.idle.empty() || _endpoint.open < _pool._options.max_connections) {
+    return false;
+  }
+  _handle = handle;
+  if (_endpoint.tail != nullptr) {
+    _endpoint.tail->_next = this;
+  } else {
+    _endpoint.head = this;
+  }
+  _endpoint.tail = this;
+  return true;
+}
+
+template <concepts::executor Executor>
+auto ConnectionPool<Executor>::pop_waiter(Endpoint& endpoint) noexcept -> Waiter* {
+  auto* waiter = endpoint.head;
+  if (waiter != nullptr) {
+    endpoint.head = waiter->_next;
+    if (endpoint.head == nullptr) {
+      endpoint.tail = nullptr;
+    }
+  }
+  return waiter;
+}
+
+template <concepts::executor Executor>
+void ConnectionPool<Executor>::release(Endpoint& endpoint,
+                                       std::optional<Socket<Executor>> socket) noexcept {
+  Waiter* waiter = nullptr;
+  {
+    std::scoped_lock lock(_mutex);
+    waiter = pop_waiter(endpoint);
+    if (socket) {
+      if (waiter != nullptr) {
+        // straight to the longest waiting checkout, nobody can take it in between.
+        waiter->_handed.emplace(std::move(*socket));
+      } else {
+        endpoint.idle.push_back(Idle{std::move(*socket), clock::now()});
+      }
+    } else {
+      --endpoint.open;
+    }
+  }
+  // like Event, the waiter runs on the releasing thread.
+  if (waiter != nullptr) {
+    waiter->_handle.resume();
+  }
+}
+} // namespace libcoro
+
+#endif // !CONNECTION_POOL_HPP
@@ -1,77 +1,378 @@
 #ifndef FILE_HPP
 #define FILE_HPP
 
+#include "libcoro/async_generator.hpp"
 #include "libcoro/io_service.hpp"
 #include "libcoro/task.hpp"
-#include <cstdio>
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
 #include <memory>
+#include <new>
+#include <stdexcept>
 #include <span>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
 
 namespace libcoro {
+namespace file {
+// O_DIRECT wants buffers, offsets and sizes aligned to the logical block size of the device,
+// 4096 covers every common one.
+constexpr std::size_t DIRECT_IO_ALIGNMENT = 4096;
+
+struct AlignedDelete {
+  void operator()(char* data) const noexcept {
+    ::operator delete[](data, std::align_val_t{DIRECT_IO_ALIGNMENT});
+  }
+};
+using AlignedBuffer = std::unique_ptr<char[], AlignedDelete>;
+
+// `size` is rounded up to a multiple of DIRECT_IO_ALIGNMENT.
+inline AlignedBuffer allocate_aligned(std::size_t size) {
+  auto rounded = (size + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+  return AlignedBuffer(
+      static_cast<char*>(::operator new[](rounded, std::align_val_t{DIRECT_IO_ALIGNMENT})));
+}
+} // namespace file
+
+namespace detail {
+// One buffer of File::chunks() and the read filling it. A single waiter, which may sit on
+// another thread than the one completing the read.
+struct ChunkSlot {
+  struct Awaiter {
+    bool await_ready() const noexcept {
+      return _slot.state.load(std::memory_order_acquire) == &_slot;
+    }
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+      void* expected = nullptr;
+      // fails when the read finished in the meantime.
+      return _slot.state.compare_exchange_strong(expected, handle.address(),
+                                                 std::memory_order_acq_rel,
+                                                 std::memory_order_acquire);
+    }
+    void await_resume() const noexcept {}
+
+    ChunkSlot& _slot;
+  };
+
+  Awaiter wait() noexcept { return Awaiter{*this}; }
+
+  // `failure` is rethrown to the consumer instead of handing out the chunk.
+  void complete(std::size_t read, std::exception_ptr failure = nullptr) noexcept {
+    bytes = read;
+    error = std::move(failure);
+    auto* waiter = state.exchange(this, std::memory_order_acq_rel);
+    if (waiter != nullptr) {
+      std::coroutine_handle<>::from_address(waiter).resume();
+    }
+  }
+
+  void reset() noexcept {
+    error = nullptr;
+    state.store(nullptr, std::memory_order_relaxed);
+  }
+
+  file::AlignedBuffer buffer{};
+  std::size_t bytes{0};
+  std::exception_ptr error{nullptr};
+  // nullptr, the address of the waiting coroutine, or this slot once the read completed.
+  std::atomic<void*> state{nullptr};
+};
+} // namespace detail
+
+// A file on a raw fd. Reads and writes go through io_uring when the service has it, and run on
+// the service's blocking pool otherwise, so a slow disk never stalls an executor or the io
+// thread. The positional calls may be issued concurrently; the sequential ones share one file
+// position and must not overlap.
 template <concepts::executor Executor>
 class File {
   using io_service_ptr = std::shared_ptr<IOService<Executor>>;
 
 public:
-  File(io_service_ptr& io_services, std::FILE* fd) noexcept: _fd(fd), _io_service(io_services) {}
+  File(io_service_ptr& io_services, int fd) noexcept: _fd(fd), _io_service(io_services) {}
 
   File(const File&) = delete;
   File& operator=(const File&) = delete;
 
-  File(File&& other) noexcept = default;
-  File& operator=(File&& other) noexcept = default;
+  File(File&& other) noexcept
+      : _fd(std::exchange(other._fd, -1)), _io_service(std::move(other._io_service)),
+        _position(other._position) {}
+  File& operator=(File&& other) noexcept {
+    if (this != &other) {
+      close();
+      _fd = std::exchange(other._fd, -1);
+      _io_service = std::move(other._io_service);
+      _position = other._position;
+    }
+    return *this;
+  }
 
   ~File() { close(); }
 
-  Task<std::span<char>> read(std::size_t size, ::off_t offset = 0);
-  Task<std::size_t> write(std::span<const char> data);
+  // positional, the bytes transferred, 0 at the end of the file, or -errno.
+  Task<::ssize_t> read(std::span<char> buffer, ::off_t offset);
+  Task<::ssize_t> write(std::span<const char> data, ::off_t offset);
+
+  // sequential, from the file position, which they advance unless they fail.
+  Task<::ssize_t> read(std::span<char> buffer);
+  Task<::ssize_t> write(std::span<const char> data);
+
+  // the returned buffer is malloc'ed and owned by the caller, empty at the end of the file.
+  // throws when the read fails.
+  Task<std::span<char>> read(std::size_t size, ::off_t offset);
+  Task<std::span<char>> read(std::size_t size);
+
+  // Streams the file from `offset` in chunks of `chunk_size`, only the last one may be shorter.
+  // `depth` buffers are reused round robin: while the consumer works on one chunk, the reads of
+  // the next depth - 1 are already in flight. A chunk stays valid until the next next(). The
+  // generator reads through its own descriptor, the file may be closed once it was created.
+  // Buffers are aligned for O_DIRECT, chunk_size and offset then have to be aligned as well.
+  // A failed read is thrown from next().
+  AsyncGenerator<std::span<const char>> chunks(std::size_t chunk_size, std::size_t depth = 2,
+                                               ::off_t offset = 0);
+
+  // the underlying descriptor, -1 once closed.
+  int fd() const noexcept { return _fd; }
 
   void close();
 
 private:
-  std::FILE* _fd;
+  // shared with the reads in flight, which may outlive the generator.
+  struct ReadAhead {
+    ReadAhead(File&& file, std::size_t depth) : file(std::move(file)), slots(depth) {}
+
+    File file;
+    std::vector<detail::ChunkSlot> slots;
+  };
+
+  static AsyncGenerator<std::span<const char>>
+  read_ahead(std::shared_ptr<ReadAhead> state, std::size_t chunk_size, ::off_t offset);
+  static Task<> fill(std::shared_ptr<ReadAhead> state, detail::ChunkSlot& slot,
+                     std::size_t chunk_size, ::off_t offset);
+
+  int _fd;
   io_service_ptr _io_service;
+  ::off_t _position{0};
 };
 } // namespace libcoro
 
 namespace libcoro {
+namespace detail {
+// fopen style mode to open(2) flags.
+inline int open_flags(const char* mode) noexcept {
+  int flags = 0;
+  bool update = false;
+  for (auto* c = mode + 1; *c != '\0'; ++c) {
+    if (*c == '+') {
+      update = true;
+    } else if (*c == 'x') {
+      flags |= O_EXCL;
+    }
+  }
+
+  switch (mode[0]) {
+  case 'w':
+    return flags | (update ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC;
+  case 'a':
+    return flags | (update ? O_RDWR : O_WRONLY) | O_CREAT | O_APPEND;
+  default:
+    return flags | (update ? O_RDWR : O_RDONLY);
+  }
+}
+} // namespace detail
+
+// `flags` as for open(2), the fd is always close-on-exec. O_DIRECT (linux) bypasses the page
+// cache: buffers then have to come from file::allocate_aligned, and offsets and sizes have to be
+// multiples of DIRECT_IO_ALIGNMENT. the file's fd is -1 when it could not be opened.
 template <concepts::executor Executor>
 inline File<Executor> open(std::shared_ptr<IOService<Executor>> io_service, const char* path,
-                           const char* mode) {
-  auto fd = std::fopen(path, mode);
+                           int flags, ::mode_t mode = 0644) {
+  auto fd = ::open(path, flags | O_CLOEXEC, mode);
   return File(io_service, fd);
 }
 
+template <concepts::executor Executor>
+inline File<Executor> open(std::shared_ptr<IOService<Executor>> io_service, const char* path,
+                           const char* mode) {
+  return open(io_service, path, detail::open_flags(mode));
+}
+
 template <concepts::executor Executor>
 void File<Executor>::close() {
-  if (_fd != nullptr) {
-    std::fclose(_fd);
+  if (_fd != -1) {
+    ::close(_fd);
+    _fd = -1;
   }
 }
 
 template <concepts::executor Executor>
-Task<std::span<char>> File<Executor>::read(std::size_t size, ::off_t offset) {
-  if (_fd == nullptr) {
+Task<::ssize_t> File<Executor>::read(std::span<char> buffer, ::off_t offset) {
+  if (_fd == -1) {
     throw std::runtime_error("File descriptor is null");
   }
 
-  co_await _io_service->schedule();
+#ifdef LIBCORO_IO_URING
+  if (_io_service->io_uring_enabled()) {
+    co_return co_await _io_service->submit([&](struct io_uring_sqe* sqe) {
+      detail::IOUring::prep_read(sqe, _fd, buffer.data(), buffer.size(), offset);
+    });
+  }
+#endif
 
-  auto bytes = std::malloc(size);
-  auto bytes_size = std::fread(bytes, sizeof(char), size, _fd);
+  co_return co_await _io_service->offload([fd = _fd, buffer, offset]() -> ::ssize_t {
+    auto bytes = ::pread(fd, buffer.data(), buffer.size(), offset);
+    return bytes < 0 ? -errno : bytes;
+  });
+}
 
-  co_return std::span<char>(static_cast<char*>(bytes), bytes_size);
+template <concepts::executor Executor>
+Task<::ssize_t> File<Executor>::write(std::span<const char> data, ::off_t offset) {
+  if (_fd == -1) {
+    throw std::runtime_error("File descriptor is null");
+  }
+
+#ifdef LIBCORO_IO_URING
+  if (_io_service->io_uring_enabled()) {
+    co_return co_await _io_service->submit([&](struct io_uring_sqe* sqe) {
+      detail::IOUring::prep_write(sqe, _fd, data.data(), data.size(), offset);
+    });
+  }
+#endif
+
+  co_return co_await _io_service->offload([fd = _fd, data, offset]() -> ::ssize_t {
+    auto bytes = ::pwrite(fd, data.data(), data.size(), offset);
+    return bytes < 0 ? -errno : bytes;
+  });
+}
+
+template <concepts::executor Executor>
+Task<::ssize_t> File<Executor>::read(std::span<char> buffer) {
+  auto bytes = co_await read(buffer, _position);
+  if (bytes > 0) {
+    _position += bytes;
+  }
+  co_return bytes;
+}
+
+template <concepts::executor Executor>
+Task<::ssize_t> File<Executor>::write(std::span<const char> data) {
+  auto bytes = co_await write(data, _position);
+  if (bytes > 0) {
+    _position += bytes;
+  }
+  co_return bytes;
+}
+
+template <concepts::executor Executor>
+Task<std::span<char>> File<Executor>::read(std::size_t size, ::off_t offset) {
+  auto buffer = static_cast<char*>(std::malloc(size));
+  if (buffer == nullptr) {
+    throw std::bad_alloc();
+  }
+  auto bytes = co_await read(std::span<char>(buffer, size), offset);
+  if (bytes <= 0) {
+    std::free(buffer);
+    if (bytes < 0) {
+      throw std::runtime_error(std::string("Failed to read file: ") + std::strerror(-bytes));
+    }
+    co_return std::span<char>();
+  }
+  co_return std::span<char>(buffer, static_cast<std::size_t>(bytes));
+}
+
+template <concepts::executor Executor>
+Task<std::span<char>> File<Executor>::read(std::size_t size) {
+  auto data = co_await read(size, _position);
+  _position += static_cast<::off_t>(data.size());
+  co_return data;
 }
 
 template <concepts::executor Executor>
-Task<std::size_t> File<Executor>::write(std::span<const char> data) {
-  if (_fd == nullptr) {
+AsyncGenerator<std::span<const char>> File<Executor>::chunks(std::size_t chunk_size,
+                                                             std::size_t depth, ::off_t offset) {
+  if (_fd == -1) {
     throw std::runtime_error("File descriptor is null");
   }
+  if (chunk_size == 0 || depth == 0) {
+    throw std::invalid_argument("chunk size and depth must not be zero");
+  }
+  auto fd = ::fcntl(_fd, F_DUPFD_CLOEXEC, 0);
+  if (fd == -1) {
+    throw std::runtime_error("Failed to duplicate file descriptor");
+  }
+
+  auto state = std::make_shared<ReadAhead>(File(_io_service, fd), depth);
+  for (auto& slot : state->slots) {
+    slot.buffer = file::allocate_aligned(chunk_size);
+  }
+  return read_ahead(std::move(state), chunk_size, offset);
+}
 
-  co_await _io_service->schedule();
+template <concepts::executor Executor>
+AsyncGenerator<std::span<const char>>
+File<Executor>::read_ahead(std::shared_ptr<ReadAhead> state, std::size_t chunk_size,
+                           ::off_t offset) {
+  auto stride = static_cast<::off_t>(chunk_size);
+  auto& io_service = *state->file._io_service;
+  for (auto& slot : state->slots) {
+    io_service.execute(fill(state, slot, chunk_size, offset));
+    offset += stride;
+  }
 
-  co_return std::fwrite(data.data(), sizeof(char), data.size(), _fd);
+  for (std::size_t i = 0;; i = (i + 1) % state->slots.size()) {
+    auto& slot = state->slots[i];
+    co_await slot.wait();
+    if (slot.error) {
+      std::rethrow_exception(slot.error);
+    }
+    if (slot.bytes == 0) {
+      co_return;
+    }
+    auto last = slot.bytes < chunk_size;
+    co_yield std::span<const char>(slot.buffer.get(), slot.bytes);
+    if (last) {
+      co_return;
+    }
+
+    // the consumer is done with this one, it takes the next chunk nobody reads yet.
+    slot.reset();
+    io_service.execute(fill(state, slot, chunk_size, offset));
+    offset += stride;
+  }
+}
+
+template <concepts::executor Executor>
+Task<> File<Executor>::fill(std::shared_ptr<ReadAhead> state, detail::ChunkSlot& slot,
+                            std::size_t chunk_size, ::off_t offset) {
+  std::size_t bytes = 0;
+  std::exception_ptr error{nullptr};
+  try {
+    // short reads only end the stream at the end of the file.
+    while (bytes < chunk_size) {
+      auto read = co_await state->file.read(
+          std::span<char>(slot.buffer.get() + bytes, chunk_size - bytes),
+          offset + static_cast<::off_t>(bytes));
+      if (read < 0) {
+        throw std::runtime_error(std::string("Failed to read file: ") + std::strerror(-read));
+      }
+      if (read == 0) {
+        break;
+      }
+      bytes += static_cast<std::size_t>(read);
+    }
+  } catch (...) {
+    // handed to the consumer, which gets it from next().
+    error = std::current_exception();
+  }
+  slot.complete(bytes, std::move(error));
 }
 } // namespace libcoro
 
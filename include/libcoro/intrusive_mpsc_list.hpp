@@ -0,0 +1,52 @@
+#ifndef INTRUSIVE_MPSC_LIST_HPP
+#define INTRUSIVE_MPSC_LIST_HPP
+
+#include <atomic>
+
+namespace libcoro {
+namespace detail {
+// Lock-free list linking through a `T* T::*Next` member of its nodes, so pushing never allocates.
+// Any thread may push; a single consumer takes everything at once with one exchange. The nodes
+// must stay alive until the consumer has seen them.
+template <typename T, T* T::*Next>
+class IntrusiveMpscList {
+public:
+  IntrusiveMpscList() = default;
+
+  IntrusiveMpscList(const IntrusiveMpscList&) = delete;
+  IntrusiveMpscList& operator=(const IntrusiveMpscList&) = delete;
+  IntrusiveMpscList(IntrusiveMpscList&&) = delete;
+  IntrusiveMpscList& operator=(IntrusiveMpscList&&) = delete;
+
+  // returns true when the list was empty, i.e. when the consumer may need a wake up.
+  bool push(T* node) noexcept {
+    auto* head = _head.load(std::memory_order_relaxed);
+    do {
+      node->*Next = head;
+    } while (!_head.compare_exchange_weak(head, node, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed));
+    return head == nullptr;
+  }
+
+  // consumer only, returns the taken nodes in push order, chained through `Next`.
+  T* take_all() noexcept {
+    auto* node = _head.exchange(nullptr, std::memory_order_seq_cst);
+    T* reversed = nullptr;
+    while (node != nullptr) {
+      auto* next = node->*Next;
+      node->*Next = reversed;
+      reversed = node;
+      node = next;
+    }
+    return reversed;
+  }
+
+  bool empty() const noexcept { return _head.load(std::memory_order_acquire) == nullptr; }
+
+private:
+  std::atomic<T*> _head{nullptr};
+};
+} // namespace detail
+} // namespace libcoro
+
+#endif // !INTRUSIVE_MPSC_LIST_HPP
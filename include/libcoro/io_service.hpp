@@ -2,16 +2,35 @@
 #define IO_SERVICE_HPP
 
 #include "concepts/executor.hpp"
+#include "libcoro/affinity.hpp"
+#include "libcoro/blocking_pool.hpp"
+#include "libcoro/buffer_pool.hpp"
 #include "libcoro/event_fd.hpp"
+#include "libcoro/intrusive_mpsc_list.hpp"
+#include "libcoro/io_uring.hpp"
+#include "libcoro/output_queue.hpp"
 #include "libcoro/poll.hpp"
 #include "libcoro/task.hpp"
+#include "libcoro/timer_wheel.hpp"
+#include "libcoro/zerocopy.hpp"
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
 #include <coroutine>
-#include <format>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <mutex>
-#include <sys/event.h>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <type_traits>
 #include <unistd.h>
+#include <vector>
 
 #ifdef __APPLE__
 #include <sys/event.h>
@@ -20,6 +39,47 @@
 #endif
 
 namespace libcoro {
+// EPOLL stands for kqueue on macOS. IO_URING falls back to EPOLL when the library was built
+// without io_uring support or the kernel refuses to create a ring.
+enum class IOBackend { EPOLL, IO_URING };
+
+namespace detail {
+// a sleep, or a readiness wait with a deadline when `state` is set. handed to the io thread,
+// which arms it on its timer wheel.
+struct TimerOperation : TimerNode, FdWaiter {
+  std::chrono::steady_clock::time_point expiry{};
+  FdState* state{nullptr};
+  PollType poll_type{PollType::READ};
+  bool timed_out{false};
+  TimerOperation* next_pending{nullptr};
+};
+} // namespace detail
+
+#ifdef LIBCORO_IO_URING
+namespace detail {
+// completion record of one submission, io_uring user_data points at it.
+struct UringOperation {
+  std::coroutine_handle<> handle{nullptr};
+  int result{0};
+  // fills in the entry, `context` is the awaiter the operation belongs to.
+  void (*prepare)(void* context, struct io_uring_sqe* sqe) noexcept {nullptr};
+  void* context{nullptr};
+  // a linked timeout entry follows when set.
+  struct __kernel_timespec* timeout{nullptr};
+  // the registered fd the operation runs on, it sits in the fd's in-flight list until it
+  // completes or the fd is deregistered.
+  FdState* state{nullptr};
+  UringOperation* prev{nullptr};
+  UringOperation* next{nullptr};
+  // waiting for free submission entries.
+  UringOperation* next_queued{nullptr};
+  bool queued{false};
+  // its fd was deregistered while it was queued, it completes with -ECANCELED unsubmitted.
+  bool cancelled{false};
+};
+} // namespace detail
+#endif
+
 template <concepts::executor Executor>
 class IOService {
   using executor_ptr = std::shared_ptr<Executor>;
@@ -30,7 +90,11 @@ class IOService {
 #endif
 
 public:
-  IOService(executor_ptr);
+  using clock = std::chrono::steady_clock;
+
+  IOService(executor_ptr, IOBackend backend = IOBackend::EPOLL);
+  // pin the io thread to `cpu`.
+  IOService(executor_ptr, std::size_t cpu, IOBackend backend = IOBackend::EPOLL);
   ~IOService();
 
   IOService(const IOService&) = delete;
@@ -38,6 +102,7 @@ public:
   IOService(IOService&&) = delete;
   IOService& operator=(IOService&&) = delete;
 
+  // the awaiter itself is the queue node, scheduling neither locks nor allocates.
   class Awaiter {
     friend class IOService;
     explicit Awaiter(IOService& io_service) noexcept: _io_service(io_service) {}
@@ -45,36 +110,445 @@ public:
   public:
     bool await_ready() const noexcept { return false; }
     void await_suspend(std::coroutine_handle<> handle) noexcept {
+      _handle = handle;
       _io_service._awaiting_size.fetch_add(1, std::memory_order_release);
-      {
-        std::scoped_lock lock(_io_service._awaiting_coroutines_mutex);
-        _io_service._awaiting_coroutines.push_back(handle);
+      if (_io_service._scheduled.push(this)) {
+        _io_service.wake_scheduler();
       }
+    }
+    void await_resume() noexcept {}
+
+  private:
+    IOService& _io_service;
+    std::coroutine_handle<> _handle{nullptr};
+    Awaiter* _next{nullptr};
+  };
 
-      bool expected = false;
-      if (_io_service._scheduler_event_fd_triggered.compare_exchange_strong(
-              expected, true, std::memory_order_release, std::memory_order_relaxed)) {
-        _io_service._scheduler_event_fd.trigger();
+#ifdef LIBCORO_IO_URING
+  // submits the entry filled in by `prepare` and resumes with the completion result, which is
+  // the syscall return value or -errno.
+  template <typename Prepare>
+  class UringAwaiter {
+    friend class IOService;
+    UringAwaiter(IOService& io_service, Prepare prepare) noexcept
+        : _io_service(io_service), _prepare(std::move(prepare)) {}
+
+  public:
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+      // set up here rather than in the constructor, the awaiter may have been moved since.
+      _operation.handle = handle;
+      _operation.prepare = [](void* context, struct io_uring_sqe* sqe) noexcept {
+        static_cast<UringAwaiter*>(context)->_prepare(sqe);
+      };
+      _operation.context = this;
+      _operation.timeout = _has_timeout ? &_timeout : nullptr;
+      _operation.state = _state;
+      return _io_service.submit_operation(_operation);
+    }
+    int await_resume() const noexcept { return _operation.result; }
+
+  private:
+    IOService& _io_service;
+    Prepare _prepare;
+    detail::FdState* _state{nullptr};
+    detail::UringOperation _operation{};
+    struct __kernel_timespec _timeout {};
+    bool _has_timeout{false};
+  };
+
+  template <typename Prepare>
+  UringAwaiter<Prepare> submit(Prepare prepare) {
+    return UringAwaiter<Prepare>{*this, std::move(prepare)};
+  }
+  // for operations on a registered fd: deregistering it cancels them, they complete with
+  // -ECANCELED.
+  template <typename Prepare>
+  UringAwaiter<Prepare> submit(detail::FdState& state, Prepare prepare) {
+    UringAwaiter<Prepare> awaiter{*this, std::move(prepare)};
+    awaiter._state = &state;
+    return awaiter;
+  }
+
+  // the operation is cancelled and completes with -ECANCELED once `timeout` expires.
+  template <typename Prepare>
+  UringAwaiter<Prepare> submit(Prepare prepare, std::chrono::nanoseconds timeout) {
+    UringAwaiter<Prepare> awaiter{*this, std::move(prepare)};
+    awaiter._has_timeout = true;
+    awaiter._timeout.tv_sec = std::chrono::duration_cast<std::chrono::seconds>(timeout).count();
+    awaiter._timeout.tv_nsec = (timeout % std::chrono::seconds(1)).count();
+    return awaiter;
+  }
+  template <typename Prepare>
+  UringAwaiter<Prepare> submit(detail::FdState& state, Prepare prepare,
+                               std::chrono::nanoseconds timeout) {
+    auto awaiter = submit(std::move(prepare), timeout);
+    awaiter._state = &state;
+    return awaiter;
+  }
+#endif
+
+  // one-shot registration for an fd that is not registered with the service. the poll record
+  // lives in the awaiting coroutine's frame and the io thread resumes the coroutine directly.
+  class PollAwaiter {
+    friend class IOService;
+    PollAwaiter(IOService& io_service, int fd, detail::PollType poll_type) noexcept
+        : _io_service(io_service), _poll_type(poll_type) {
+      _poll.set_fd(fd);
+    }
+
+  public:
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      _poll.set_waiting_coroutine(handle);
+      _io_service.arm_poll(_poll, _poll_type);
+    }
+    detail::PollStatus await_resume() const noexcept { return _poll.status(); }
+
+  private:
+    IOService& _io_service;
+    detail::PollType _poll_type;
+    detail::Poll _poll{};
+  };
+
+  // parks the coroutine until the registered fd is ready in one direction.
+  class ReadinessAwaiter {
+    friend class IOService;
+    ReadinessAwaiter(IOService& io_service, detail::FdState& state,
+                     detail::PollType poll_type) noexcept
+        : _io_service(io_service), _state(state), _poll_type(poll_type) {}
+
+  public:
+    bool await_ready() noexcept {
+      if (!_state.can_proceed(_poll_type)) {
+        return false;
       }
+      _waiter.status = _state.status(_poll_type);
+      return true;
+    }
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+      _waiter.handle = handle;
+      _io_service._awaiting_size.fetch_add(1, std::memory_order_release);
+      if (!_state.add_waiter(_poll_type, _waiter)) {
+        _io_service._awaiting_size.fetch_sub(1, std::memory_order_release);
+        return false;
+      }
+      return true;
+    }
+    // EVENT_CLOSED when the fd was deregistered while waiting, the record may be gone by then.
+    detail::PollStatus await_resume() const noexcept { return _waiter.status; }
+
+  private:
+    IOService& _io_service;
+    detail::FdState& _state;
+    detail::PollType _poll_type;
+    detail::FdWaiter _waiter{};
+  };
+
+#ifdef __linux__
+  // parks the sender of a MSG_ZEROCOPY send until the kernel has released its buffer.
+  class ZerocopyAwaiter {
+    friend class IOService;
+    ZerocopyAwaiter(IOService& io_service, detail::FdState& state, std::uint32_t sequence) noexcept
+        : _io_service(io_service), _state(state), _sequence(sequence) {}
+
+  public:
+    bool await_ready() const noexcept { return _state.zerocopy_released(_sequence); }
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+      _io_service._awaiting_size.fetch_add(1, std::memory_order_release);
+      if (!_state.add_zerocopy_waiter(handle, _sequence)) {
+        _io_service._awaiting_size.fetch_sub(1, std::memory_order_release);
+        return false;
+      }
+      return true;
+    }
+    void await_resume() const noexcept {}
+
+  private:
+    IOService& _io_service;
+    detail::FdState& _state;
+    std::uint32_t _sequence;
+  };
+#endif
+
+  // resumes the coroutine once its expiry has passed.
+  class SleepAwaiter {
+    friend class IOService;
+    SleepAwaiter(IOService& io_service, clock::time_point expiry) noexcept
+        : _io_service(io_service) {
+      _operation.expiry = expiry;
     }
-    void await_resume() noexcept {}
+
+  public:
+    bool await_ready() const noexcept { return _operation.expiry <= clock::now(); }
+    void await_suspend(std::coroutine_handle<> handle) noexcept {
+      _operation.handle = handle;
+      _io_service.submit_timer(_operation);
+    }
+    void await_resume() const noexcept {}
 
   private:
     IOService& _io_service;
+    detail::TimerOperation _operation{};
+  };
+
+  // like ReadinessAwaiter, but gives up with EVENT_TIMEOUT once the deadline has passed.
+  class TimedReadinessAwaiter {
+    friend class IOService;
+    TimedReadinessAwaiter(IOService& io_service, detail::FdState& state,
+                          detail::PollType poll_type, clock::time_point deadline) noexcept
+        : _io_service(io_service) {
+      _operation.expiry = deadline;
+      _operation.state = &state;
+      _operation.poll_type = poll_type;
+    }
+
+  public:
+    bool await_ready() noexcept {
+      if (_operation.state->can_proceed(_operation.poll_type)) {
+        _operation.status = _operation.state->status(_operation.poll_type);
+        return true;
+      }
+      _operation.timed_out = _operation.expiry <= clock::now();
+      return _operation.timed_out;
+    }
+    void await_suspend(std::coroutine_handle<> handle) noexcept {
+      _operation.handle = handle;
+      _io_service.submit_timer(_operation);
+    }
+    detail::PollStatus await_resume() const noexcept {
+      if (_operation.timed_out) {
+        return detail::PollStatus::EVENT_TIMEOUT;
+      }
+      return _operation.status;
+    }
+
+  private:
+    IOService& _io_service;
+    detail::TimerOperation _operation{};
+  };
+
+  // a timed wait on an fd registered for the duration of the wait only.
+  class TimedPollAwaiter {
+    friend class IOService;
+    TimedPollAwaiter(IOService& io_service, std::unique_ptr<detail::FdState> state,
+                     detail::PollType poll_type, clock::time_point deadline) noexcept
+        : _io_service(io_service),
+          _state(std::move(state)),
+          _awaiter(io_service, *_state, poll_type, deadline) {}
+
+  public:
+    TimedPollAwaiter(const TimedPollAwaiter&) = delete;
+    TimedPollAwaiter& operator=(const TimedPollAwaiter&) = delete;
+    TimedPollAwaiter(TimedPollAwaiter&&) = delete;
+    TimedPollAwaiter& operator=(TimedPollAwaiter&&) = delete;
+    ~TimedPollAwaiter() { _io_service.deregister_fd(std::move(_state)); }
+
+    bool await_ready() noexcept { return _awaiter.await_ready(); }
+    void await_suspend(std::coroutine_handle<> handle) noexcept { _awaiter.await_suspend(handle); }
+    detail::PollStatus await_resume() const noexcept { return _awaiter.await_resume(); }
+
+  private:
+    IOService& _io_service;
+    std::unique_ptr<detail::FdState> _state;
+    TimedReadinessAwaiter _awaiter;
+  };
+
+  // runs `function` on the service's blocking pool and resumes on the executor with its result,
+  // or rethrows what it threw.
+  template <typename F>
+  class BlockingAwaiter: detail::BlockingJob {
+    friend class IOService;
+    BlockingAwaiter(IOService& io_service, F function) noexcept
+        : _function(std::move(function)), _resume(io_service) {
+      run = &BlockingAwaiter::execute;
+    }
+
+  public:
+    using result_type = std::invoke_result_t<F&>;
+    static_assert(!std::is_reference_v<result_type>, "offloaded calls return values");
+
+    BlockingAwaiter(const BlockingAwaiter&) = delete;
+    BlockingAwaiter& operator=(const BlockingAwaiter&) = delete;
+    // only before it is awaited, e.g. when passed to sync().
+    BlockingAwaiter(BlockingAwaiter&& other) noexcept(std::is_nothrow_move_constructible_v<F>)
+        : _function(std::move(other._function)), _resume(other._resume._io_service) {
+      run = &BlockingAwaiter::execute;
+    }
+    BlockingAwaiter& operator=(BlockingAwaiter&&) = delete;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      _resume._handle = handle;
+      _resume._io_service._awaiting_size.fetch_add(1, std::memory_order_release);
+      _resume._io_service._blocking_pool.submit(*this);
+    }
+    result_type await_resume() {
+      if (_exception) {
+        std::rethrow_exception(_exception);
+      }
+      if constexpr (!std::is_void_v<result_type>) {
+        return std::move(*_result);
+      }
+    }
+
+  private:
+    using storage_type = std::conditional_t<std::is_void_v<result_type>, bool, result_type>;
+
+    static void execute(detail::BlockingJob* job) noexcept {
+      auto* self = static_cast<BlockingAwaiter*>(job);
+      try {
+        if constexpr (std::is_void_v<result_type>) {
+          std::invoke(self->_function);
+        } else {
+          self->_result.emplace(std::invoke(self->_function));
+        }
+      } catch (...) {
+        self->_exception = std::current_exception();
+      }
+      // handed back like schedule(), the coroutine may be gone right after the push.
+      auto& io_service = self->_resume._io_service;
+      if (io_service._scheduled.push(&self->_resume)) {
+        io_service.wake_scheduler();
+      }
+    }
+
+    F _function;
+    std::optional<storage_type> _result{std::nullopt};
+    std::exception_ptr _exception{nullptr};
+    Awaiter _resume;
   };
 
   Awaiter schedule() { return Awaiter{*this}; }
+  // `co_await offload(f)` runs blocking work such as stat, fsync or getaddrinfo off the executor
+  // and the io thread. `function` is moved into the awaiter, references it captures must outlive
+  // the co_await.
+  template <typename F>
+  BlockingAwaiter<F> offload(F function) noexcept {
+    return BlockingAwaiter<F>{*this, std::move(function)};
+  }
+  SleepAwaiter sleep_for(clock::duration duration) noexcept {
+    return SleepAwaiter{*this, clock::now() + duration};
+  }
+  SleepAwaiter sleep_until(clock::time_point time_point) noexcept {
+    return SleepAwaiter{*this, time_point};
+  }
   void execute(Task<void>&& task);
   void close();
 
-  Task<detail::PollStatus> poll(int fd, detail::PollType poll_type);
+  // one-shot registration for fds that are not registered with the service.
+  PollAwaiter poll(int fd, detail::PollType poll_type) noexcept {
+    return PollAwaiter{*this, fd, poll_type};
+  }
+  ReadinessAwaiter poll(detail::FdState& state, detail::PollType poll_type);
+  // EVENT_TIMEOUT when the fd did not turn ready within `timeout`. one direction at a time.
+  TimedPollAwaiter poll(int fd, detail::PollType poll_type, clock::duration timeout);
+  TimedReadinessAwaiter poll(detail::FdState& state, detail::PollType poll_type,
+                             clock::duration timeout);
+
+  // registers `fd` once, edge-triggered, for both directions. returns nullptr when the fd cannot
+  // be polled (regular files for instance).
+  std::unique_ptr<detail::FdState> register_fd(int fd);
+  // must be called before the fd is closed. the record is freed by the io thread once no event
+  // referring to it can be in flight anymore.
+  void deregister_fd(std::unique_ptr<detail::FdState> state);
+  ReadinessAwaiter wait_ready(detail::FdState& state, detail::PollType poll_type) noexcept {
+    return ReadinessAwaiter{*this, state, poll_type};
+  }
+  TimedReadinessAwaiter wait_ready(detail::FdState& state, detail::PollType poll_type,
+                                   clock::time_point deadline) noexcept {
+    return TimedReadinessAwaiter{*this, state, poll_type, deadline};
+  }
+#ifdef __linux__
+  ZerocopyAwaiter wait_zerocopy(detail::FdState& state, std::uint32_t sequence) noexcept {
+    return ZerocopyAwaiter{*this, state, sequence};
+  }
+#endif
+
+  // has the io thread write out `output` before it waits for events again. called from an
+  // executor turn, the request is made once the turn ends so the turn's later sends join it.
+  void request_flush(detail::OutputQueue& output) noexcept {
+    output.request_flush = [](void* context, detail::OutputQueue& output) noexcept {
+      static_cast<IOService*>(context)->queue_flush(output);
+    };
+    output.request_context = this;
+    if (!detail::OutputCork::hold(output)) {
+      queue_flush(output);
+    }
+  }
 
   std::size_t size() const noexcept { return _awaiting_size.load(std::memory_order_acquire); }
 
+  // receive buffers shared by every socket of this service.
+  detail::BufferPool& buffer_pool() noexcept { return _buffer_pool; }
+  // the threads behind offload().
+  detail::BlockingPool& blocking_pool() noexcept { return _blocking_pool; }
+
+  bool io_uring_enabled() const noexcept {
+#ifdef LIBCORO_IO_URING
+    return _io_uring != nullptr;
+#else
+    return false;
+#endif
+  }
+
 private:
+  // fire-and-forget coroutine owning a task started through execute().
+  struct Detached {
+    struct promise_type {
+      Detached get_return_object() noexcept { return {}; }
+      std::suspend_never initial_suspend() noexcept { return {}; }
+      std::suspend_never final_suspend() noexcept { return {}; }
+      void return_void() noexcept {}
+      void unhandled_exception() noexcept { std::terminate(); }
+    };
+  };
+  static Detached spawn(IOService& io_service, Task<void> task);
+
   void background_thread_function();
   void process_scheduled_tasks();
+  void wake_scheduler() noexcept;
+  // hands `_handles_to_resume` to the executor, in one batch when it supports that.
+  void resume_handles();
+  void submit_timer(detail::TimerOperation& operation) noexcept;
+  void arm_timer(detail::TimerOperation& operation);
+  void arm_pending_timers();
+  void expire_timer(detail::TimerNode& node);
+  // milliseconds until the next timer is due, -1 when none is pending.
+  int next_timeout() const noexcept;
+#ifdef LIBCORO_IO_URING
+  bool submit_operation(detail::UringOperation& operation) noexcept;
+  void process_io_uring_completions();
+  // submits a cancellation for every operation in flight on `state`. takes the ring lock.
+  // returns whether one of them was still queued and is left for the io thread to resume.
+  bool cancel_uring_operations(detail::FdState& state) noexcept;
+  // the ring lock is held for the ones below.
+  // fills in the entries for `operation`, false when the submission queue has no room.
+  bool prepare_uring_operation(detail::UringOperation& operation) noexcept;
+  // submits queued operations in order for as long as there is room. io thread only.
+  void submit_queued_uring_operations();
+  static void unlink_uring_operation(detail::UringOperation& operation) noexcept;
+#endif
+  void arm_poll(detail::Poll& poll, detail::PollType poll_type);
   void process_poll_event(detail::Poll*, detail::PollStatus, event_struct*);
+  void process_fd_event(detail::FdState*, event_struct*);
+  void wake_waiter(detail::FdState* state, detail::PollType poll_type);
+  void queue_flush(detail::OutputQueue& output) noexcept {
+    if (_pending_output.push(&output)) {
+      wake_scheduler();
+    }
+  }
+  void flush_pending_output() noexcept;
+  void release_retired_fd_states();
+
+  // registered fd records are tagged in the low bit of the event user data.
+  static void* tag_fd_state(detail::FdState* state) noexcept {
+    return reinterpret_cast<void*>(reinterpret_cast<std::uintptr_t>(state) | 1);
+  }
+  static detail::FdState* untag_fd_state(void* data) noexcept {
+    auto value = reinterpret_cast<std::uintptr_t>(data);
+    return (value & 1) ? reinterpret_cast<detail::FdState*>(value & ~std::uintptr_t{1}) : nullptr;
+  }
 #ifdef __APPLE__
   detail::PollStatus flag_to_poll_status(u_short flags);
 #elif __linux__
@@ -85,30 +559,55 @@ private:
   executor_ptr _executor{nullptr};
 
   int _poll_fd{-1};
-  std::array<struct kevent, 16> _events{};
+  std::array<event_struct, 16> _events{};
 
   detail::EventFD _scheduler_event_fd{};
   detail::EventFD _wake_up_event_fd{};
-  std::atomic<bool> _scheduler_event_fd_triggered{false};
 
-  std::mutex _awaiting_coroutines_mutex{};
-  std::vector<std::coroutine_handle<>> _awaiting_coroutines{};
+  // the scheduler event fd is only triggered when either list turns non-empty.
+  detail::IntrusiveMpscList<Awaiter, &Awaiter::_next> _scheduled{};
+  // armed by the io thread.
+  detail::IntrusiveMpscList<detail::TimerOperation, &detail::TimerOperation::next_pending>
+      _pending_timers{};
+
+  // queues of coalescing sockets with data to write, drained once per loop iteration.
+  detail::IntrusiveMpscList<detail::OutputQueue, &detail::OutputQueue::next_pending>
+      _pending_output{};
+
+  // io thread only.
+  detail::TimerWheel _timer_wheel{};
 
   std::vector<std::coroutine_handle<>> _handles_to_resume{};
 
+  std::mutex _retired_fd_states_mutex{};
+  std::vector<std::unique_ptr<detail::FdState>> _retired_fd_states{};
+
   std::atomic<std::size_t> _awaiting_size{0};
 
+  detail::BufferPool _buffer_pool{};
+  detail::BlockingPool _blocking_pool{};
+
   std::atomic<bool> _close_requested{false};
+
+#ifdef LIBCORO_IO_URING
+  std::unique_ptr<detail::IOUring> _io_uring{nullptr};
+  // the submission queue has a single producer side, submitting threads take turns.
+  std::mutex _io_uring_mutex{};
+  // operations that found the submission queue full, submitted once completions made room.
+  detail::UringOperation* _queued_uring_head{nullptr};
+  detail::UringOperation* _queued_uring_tail{nullptr};
+  std::atomic<bool> _has_queued_uring{false};
+#endif
 };
 } // namespace libcoro
 
 namespace libcoro {
 template <concepts::executor Executor>
-IOService<Executor>::IOService(IOService::executor_ptr executor)
+IOService<Executor>::IOService(IOService::executor_ptr executor, IOBackend backend)
 #ifdef __APPLE__
-    : _poll_fd(::kqueue()), _executor(executor) {
+    : _executor(executor), _poll_fd(::kqueue()) {
 #elif __linux__
-    : _poll_fd(::epoll_create1(0)), _executor(executor) {
+    : _executor(executor), _poll_fd(::epoll_create1(0)) {
 #endif
   if (_poll_fd == -1) {
     throw std::runtime_error("Failed to create kqueue");
@@ -132,9 +631,32 @@ IOService<Executor>::IOService(IOService::executor_ptr executor)
   // clang-format on
 #endif
 
+#ifdef LIBCORO_IO_URING
+  if (backend == IOBackend::IO_URING && detail::IOUring::supported()) {
+    _io_uring = std::make_unique<detail::IOUring>(1024);
+
+    // completions are picked up from the same loop as every other event.
+    struct epoll_event uring_event {};
+    uring_event.events = EPOLLIN;
+    uring_event.data.fd = _io_uring->fd();
+    if (::epoll_ctl(_poll_fd, EPOLL_CTL_ADD, _io_uring->fd(), &uring_event) == -1) {
+      _io_uring.reset();
+    }
+  }
+#else
+  (void)backend;
+#endif
+
   _io_thread = std::thread([this]() { background_thread_function(); });
 }
 
+template <concepts::executor Executor>
+IOService<Executor>::IOService(IOService::executor_ptr executor, std::size_t cpu,
+                               IOBackend backend)
+    : IOService(executor, backend) {
+  detail::pin_thread(_io_thread, cpu);
+}
+
 template <concepts::executor Executor>
 IOService<Executor>::~IOService() {
   close();
@@ -150,6 +672,8 @@ void IOService<Executor>::close() {
     if (_io_thread.joinable()) {
       _io_thread.join();
     }
+    // idle by now, the io thread only stops once nothing is awaited anymore.
+    _blocking_pool.shutdown();
 
     if (_poll_fd != -1) {
       ::close(_poll_fd);
@@ -158,39 +682,244 @@ void IOService<Executor>::close() {
 
     _scheduler_event_fd.close();
     _wake_up_event_fd.close();
+
+#ifdef LIBCORO_IO_URING
+    _io_uring.reset();
+#endif
   }
 }
 
 template <concepts::executor Executor>
-Task<detail::PollStatus> IOService<Executor>::poll(int fd, detail::PollType poll_type) {
-  _awaiting_size.fetch_add(1, std::memory_order_release);
+void IOService<Executor>::execute(Task<void>&& task) {
+  spawn(*this, std::move(task));
+}
+
+template <concepts::executor Executor>
+auto IOService<Executor>::spawn(IOService& io_service, Task<void> task) -> Detached {
+  co_await io_service.schedule();
+  co_await task;
+}
 
-  detail::Poll poll{};
-  poll.set_fd(fd);
+template <concepts::executor Executor>
+void IOService<Executor>::arm_poll(detail::Poll& poll, detail::PollType poll_type) {
+  // the waiting coroutine is set before the fd is armed, so the io thread never has to wait
+  // for it to show up.
+  _awaiting_size.fetch_add(1, std::memory_order_release);
 
 #ifdef __APPLE__
   struct kevent event[1];
-  EV_SET(&event[0], fd, static_cast<short>(poll_type), EV_ADD | EV_ENABLE | EV_ONESHOT, 0, 0,
-         &poll);
-
-  ::kevent(_poll_fd, event, 1, nullptr, 0, nullptr);
+  EV_SET(&event[0], poll.fd(), static_cast<short>(poll_type), EV_ADD | EV_ENABLE | EV_ONESHOT, 0,
+         0, &poll);
+  if (::kevent(_poll_fd, event, 1, nullptr, 0, nullptr) == -1) {
 #elif __linux__
   struct epoll_event event {};
   event.events = static_cast<uint32_t>(poll_type) | EPOLLONESHOT | EPOLLRDHUP;
   event.data.ptr = &poll;
+  if (::epoll_ctl(_poll_fd, EPOLL_CTL_ADD, poll.fd(), &event) == -1) {
+#endif
+    _awaiting_size.fetch_sub(1, std::memory_order_release);
+    throw std::runtime_error("epoll_ctl failed on fd " + std::to_string(poll.fd()));
+  }
+}
+
+template <concepts::executor Executor>
+auto IOService<Executor>::poll(detail::FdState& state, detail::PollType poll_type)
+    -> ReadinessAwaiter {
+  if (poll_type != detail::PollType::READ && poll_type != detail::PollType::WRITE) {
+    throw std::invalid_argument("registered fds are polled for one direction at a time");
+  }
+  return wait_ready(state, poll_type);
+}
+
+template <concepts::executor Executor>
+auto IOService<Executor>::poll(int fd, detail::PollType poll_type, clock::duration timeout)
+    -> TimedPollAwaiter {
+  if (poll_type != detail::PollType::READ && poll_type != detail::PollType::WRITE) {
+    throw std::invalid_argument("timed polls wait for one direction at a time");
+  }
+
+  // registered for the duration of the wait only, like the one-shot poll.
+  auto state = register_fd(fd);
+  if (!state) {
+    throw std::runtime_error("epoll_ctl failed on fd " + std::to_string(fd));
+  }
+  return TimedPollAwaiter{*this, std::move(state), poll_type, clock::now() + timeout};
+}
+
+template <concepts::executor Executor>
+auto IOService<Executor>::poll(detail::FdState& state, detail::PollType poll_type,
+                               clock::duration timeout) -> TimedReadinessAwaiter {
+  if (poll_type != detail::PollType::READ && poll_type != detail::PollType::WRITE) {
+    throw std::invalid_argument("registered fds are polled for one direction at a time");
+  }
+  return wait_ready(state, poll_type, clock::now() + timeout);
+}
+
+template <concepts::executor Executor>
+std::unique_ptr<detail::FdState> IOService<Executor>::register_fd(int fd) {
+  auto state = std::make_unique<detail::FdState>(fd);
+
+#ifdef __APPLE__
+  struct kevent event[2];
+  EV_SET(&event[0], fd, EVFILT_READ, EV_ADD | EV_ENABLE | EV_CLEAR, 0, 0,
+         tag_fd_state(state.get()));
+  EV_SET(&event[1], fd, EVFILT_WRITE, EV_ADD | EV_ENABLE | EV_CLEAR, 0, 0,
+         tag_fd_state(state.get()));
+  if (::kevent(_poll_fd, event, 2, nullptr, 0, nullptr) == -1) {
+    return nullptr;
+  }
+#elif __linux__
+  struct epoll_event event {};
+  event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  event.data.ptr = tag_fd_state(state.get());
   if (::epoll_ctl(_poll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
-    throw std::runtime_error(std::format("epoll_ctl failed on fd {}", fd));
+    return nullptr;
   }
 #endif
 
-  auto result = co_await poll;
+  return state;
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::deregister_fd(std::unique_ptr<detail::FdState> state) {
+  if (!state) {
+    return;
+  }
+
+#ifdef __APPLE__
+  struct kevent event[2];
+  EV_SET(&event[0], state->fd(), EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+  EV_SET(&event[1], state->fd(), EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+  ::kevent(_poll_fd, event, 2, nullptr, 0, nullptr);
+#elif __linux__
+  ::epoll_ctl(_poll_fd, EPOLL_CTL_DEL, state->fd(), nullptr);
+#endif
+
+  // coroutines still parked on it are resumed with EVENT_CLOSED by the io thread, which also
+  // may hold an event for it from the current epoll_wait round.
+  state->set_closed();
+  auto parked = state->has_waiter();
+#ifdef LIBCORO_IO_URING
+  if (_io_uring && cancel_uring_operations(*state)) {
+    parked = true;
+  }
+#endif
+  {
+    std::scoped_lock lock(_retired_fd_states_mutex);
+    _retired_fd_states.emplace_back(std::move(state));
+  }
+  if (parked) {
+    wake_scheduler();
+  }
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::process_fd_event(detail::FdState* state, event_struct* event) {
+  bool readable = false;
+  bool writable = false;
+
+#ifdef __APPLE__
+  if (event->flags & EV_ERROR) {
+    state->set_error();
+  }
+  if (event->filter == EVFILT_READ) {
+    if (event->flags & EV_EOF) {
+      state->set_hangup(detail::PollType::READ);
+    }
+    readable = true;
+  } else if (event->filter == EVFILT_WRITE) {
+    if (event->flags & EV_EOF) {
+      state->set_hangup(detail::PollType::WRITE);
+    }
+    writable = true;
+  }
+#elif __linux__
+  auto events = event->events;
+  if ((events & EPOLLERR) && state->zerocopy()) {
+    // zerocopy completions are queued as errors, they are not a failure of the socket.
+    auto harvest = detail::harvest_zerocopy(state->fd());
+    if (harvest.completed) {
+      state->release_zerocopy(harvest.released);
+      if (auto handle = state->take_zerocopy_waiter()) {
+        _awaiting_size.fetch_sub(1, std::memory_order_release);
+        _handles_to_resume.push_back(handle);
+      }
+      if (!harvest.error) {
+        events &= ~EPOLLERR;
+      }
+    }
+  }
+  if (events & EPOLLERR) {
+    state->set_error();
+  }
+  if (events & (EPOLLRDHUP | EPOLLHUP)) {
+    state->set_hangup(detail::PollType::READ);
+  }
+  if (events & EPOLLHUP) {
+    state->set_hangup(detail::PollType::WRITE);
+  }
+  readable = events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR);
+  writable = events & (EPOLLOUT | EPOLLHUP | EPOLLERR);
+#endif
+
+  if (readable) {
+    state->set_ready(detail::PollType::READ);
+    wake_waiter(state, detail::PollType::READ);
+  }
+  if (writable) {
+    state->set_ready(detail::PollType::WRITE);
+    if (auto* output = state->output()) {
+      // whatever an earlier flush left behind.
+      output->flush();
+    }
+    wake_waiter(state, detail::PollType::WRITE);
+  }
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::wake_waiter(detail::FdState* state, detail::PollType poll_type) {
+  auto* waiter = state->take_waiter(poll_type);
+  if (waiter == nullptr) {
+    return;
+  }
+  if (auto* timer = state->timer(poll_type)) {
+    _timer_wheel.cancel(*timer);
+    state->set_timer(poll_type, nullptr);
+  }
+  waiter->status = state->status(poll_type);
   _awaiting_size.fetch_sub(1, std::memory_order_release);
-  co_return result;
+  _handles_to_resume.push_back(waiter->handle);
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::release_retired_fd_states() {
+  std::vector<std::unique_ptr<detail::FdState>> retired;
+  {
+    std::scoped_lock lock(_retired_fd_states_mutex);
+    retired.swap(_retired_fd_states);
+  }
+  // a timed wait may still be on its way to the io thread.
+  arm_pending_timers();
+  for (auto& state : retired) {
+    wake_waiter(state.get(), detail::PollType::READ);
+    wake_waiter(state.get(), detail::PollType::WRITE);
+  }
+  // a queue waiting for its flush may belong to one of the retired records.
+  flush_pending_output();
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::flush_pending_output() noexcept {
+  for (auto* output = _pending_output.take_all(); output != nullptr;) {
+    auto* next = output->next_pending;
+    output->flush();
+    output = next;
+  }
 }
 
 template <concepts::executor Executor>
 void IOService<Executor>::process_poll_event(detail::Poll* poll, detail::PollStatus status,
-                                             event_struct* event) {
+                                             [[maybe_unused]] event_struct* event) {
   if (!poll->processed()) {
     std::atomic_thread_fence(std::memory_order_acquire);
     poll->set_processed(true);
@@ -200,15 +929,12 @@ void IOService<Executor>::process_poll_event(detail::Poll* poll, detail::PollSta
       event->flags = EV_DELETE;
       ::kevent(_poll_fd, event, 1, nullptr, 0, nullptr);
 #elif __linux__
-      ::epoll_ctl(_poll_fd, EPOLL_CTL_DEL, poll.fd(), nullptr);
+      ::epoll_ctl(_poll_fd, EPOLL_CTL_DEL, poll->fd(), nullptr);
 #endif
     }
 
     poll->set_status(status);
-    while (poll->waiting_coroutine()) {
-      std::atomic_thread_fence(std::memory_order_acquire);
-    }
-
+    _awaiting_size.fetch_sub(1, std::memory_order_release);
     _handles_to_resume.push_back(poll->waiting_coroutine());
   }
 }
@@ -231,7 +957,7 @@ detail::PollStatus IOService<Executor>::event_to_poll_status(uint32_t events) {
     return detail::PollStatus::EVENT_CLOSED;
   } else if (events & EPOLLERR) {
     return detail::PollStatus::EVENT_ERROR;
-  } else if (events & EPOLLIN || event & EPOLLOUT) {
+  } else if (events & EPOLLIN || events & EPOLLOUT) {
     return detail::PollStatus::EVENT_READY;
   }
 
@@ -242,14 +968,22 @@ detail::PollStatus IOService<Executor>::event_to_poll_status(uint32_t events) {
 template <concepts::executor Executor>
 void IOService<Executor>::background_thread_function() {
   while (!_close_requested.load(std::memory_order_acquire) || size() > 0) {
+    auto timeout = next_timeout();
 #ifdef __APPLE__
-    int nevents = ::kevent(_poll_fd, nullptr, 0, _events.data(), 16, nullptr);
+    struct timespec timeout_spec {
+      timeout / 1000, (timeout % 1000) * 1000000
+    };
+    int nevents = ::kevent(_poll_fd, nullptr, 0, _events.data(), 16,
+                           timeout == -1 ? nullptr : &timeout_spec);
     if (nevents == -1) {
       throw std::runtime_error("Failed to kevent");
     }
 #elif __linux__
-    auto nevents = ::epoll_wait(_poll_fd, _events.data(), 16, -1);
+    auto nevents = ::epoll_wait(_poll_fd, _events.data(), 16, timeout);
 #endif
+    // before arming anything new, so insertions see the current tick.
+    _timer_wheel.advance(clock::now(), [this](detail::TimerNode& node) { expire_timer(node); });
+
     if (nevents > 0) {
       for (int i = 0; i < nevents; ++i) {
 #ifdef __APPLE__
@@ -264,6 +998,16 @@ void IOService<Executor>::background_thread_function() {
         } else if (_events[i].data.fd == _wake_up_event_fd.event_fd) {
 #endif
           // do nothing, just wake up the kevent.
+#ifdef LIBCORO_IO_URING
+        } else if (_io_uring && _events[i].data.fd == _io_uring->fd()) {
+          process_io_uring_completions();
+#endif
+#ifdef __APPLE__
+        } else if (auto* state = untag_fd_state(_events[i].udata)) {
+#elif __linux__
+        } else if (auto* state = untag_fd_state(_events[i].data.ptr)) {
+#endif
+          process_fd_event(state, &_events[i]);
         } else {
 #ifdef __APPLE__
           process_poll_event(static_cast<detail::Poll*>(_events[i].udata),
@@ -274,30 +1018,264 @@ void IOService<Executor>::background_thread_function() {
 #endif
         }
       }
+      // also writes out what coalescing sockets queued, before waiting again.
+      release_retired_fd_states();
     }
     if (!_handles_to_resume.empty()) {
-      for (auto handle : _handles_to_resume) {
-        _executor->resume(handle);
-      }
-      _handles_to_resume.clear();
+      resume_handles();
     }
   }
 }
 
+#ifdef LIBCORO_IO_URING
+template <concepts::executor Executor>
+bool IOService<Executor>::submit_operation(detail::UringOperation& operation) noexcept {
+  std::scoped_lock lock(_io_uring_mutex);
+
+  // deregistering sets the flag before it takes the ring lock, so either the operation is
+  // refused here or it is in the list by the time the fd's operations get cancelled.
+  if (operation.state != nullptr && operation.state->closed()) {
+    operation.result = -ECANCELED;
+    return false;
+  }
+
+  if (auto* state = operation.state) {
+    operation.prev = nullptr;
+    operation.next = state->uring_operations;
+    if (operation.next != nullptr) {
+      operation.next->prev = &operation;
+    }
+    state->uring_operations = &operation;
+  }
+  _awaiting_size.fetch_add(1, std::memory_order_release);
+
+  // behind the ones already waiting, so operations on one socket keep their order.
+  if (_queued_uring_head != nullptr || !prepare_uring_operation(operation)) {
+    operation.queued = true;
+    if (_queued_uring_tail != nullptr) {
+      _queued_uring_tail->next_queued = &operation;
+    } else {
+      _queued_uring_head = &operation;
+    }
+    _queued_uring_tail = &operation;
+    _has_queued_uring.store(true, std::memory_order_release);
+    // the io thread retries at the latest once completions are in.
+    wake_scheduler();
+    return true;
+  }
+
+  // on failure the entries stay queued, the io thread retries after the next completion.
+  // completions are reaped under the lock, so `operation` stays alive until it is released.
+  _io_uring->submit();
+  return true;
+}
+
+template <concepts::executor Executor>
+bool IOService<Executor>::prepare_uring_operation(detail::UringOperation& operation) noexcept {
+  const unsigned needed = operation.timeout != nullptr ? 2 : 1;
+  if (_io_uring->available() < needed) {
+    _io_uring->submit();
+    if (_io_uring->available() < needed) {
+      return false;
+    }
+  }
+
+  auto* sqe = _io_uring->get_sqe();
+  operation.prepare(operation.context, sqe);
+  sqe->user_data = reinterpret_cast<std::uint64_t>(&operation);
+  if (operation.timeout != nullptr) {
+    sqe->flags |= IOSQE_IO_LINK;
+    auto* timeout_sqe = _io_uring->get_sqe();
+    detail::IOUring::prep_link_timeout(timeout_sqe, operation.timeout);
+    timeout_sqe->user_data = 0;
+  }
+  return true;
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::submit_queued_uring_operations() {
+  std::size_t cancelled = 0;
+  while (auto* operation = _queued_uring_head) {
+    if (!operation->cancelled && !prepare_uring_operation(*operation)) {
+      break;
+    }
+    _queued_uring_head = std::exchange(operation->next_queued, nullptr);
+    operation->queued = false;
+    if (operation->cancelled) {
+      operation->result = -ECANCELED;
+      _handles_to_resume.push_back(operation->handle);
+      ++cancelled;
+    }
+  }
+  if (_queued_uring_head == nullptr) {
+    _queued_uring_tail = nullptr;
+    _has_queued_uring.store(false, std::memory_order_release);
+  }
+  _awaiting_size.fetch_sub(cancelled, std::memory_order_release);
+  _io_uring->submit();
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::process_io_uring_completions() {
+  std::scoped_lock lock(_io_uring_mutex);
+
+  std::size_t completed = 0;
+  _io_uring->for_each_completion([&](std::uint64_t user_data, int result, unsigned) {
+    if (user_data == 0) {
+      // linked timeout and cancellation entries.
+      return;
+    }
+    auto* operation = reinterpret_cast<detail::UringOperation*>(user_data);
+    operation->result = result;
+    if (operation->state != nullptr) {
+      unlink_uring_operation(*operation);
+    }
+    _handles_to_resume.push_back(operation->handle);
+    ++completed;
+  });
+  _awaiting_size.fetch_sub(completed, std::memory_order_release);
+
+  submit_queued_uring_operations();
+}
+
+template <concepts::executor Executor>
+bool IOService<Executor>::cancel_uring_operations(detail::FdState& state) noexcept {
+  std::scoped_lock lock(_io_uring_mutex);
+
+  bool queued = false;
+  while (auto* operation = state.uring_operations) {
+    unlink_uring_operation(*operation);
+    if (operation->queued) {
+      // never reached the kernel, the io thread resumes it.
+      operation->cancelled = true;
+      queued = true;
+      continue;
+    }
+    auto* sqe = _io_uring->get_sqe();
+    if (sqe == nullptr) {
+      _io_uring->submit();
+      sqe = _io_uring->get_sqe();
+    }
+    // with the queue still full the operation is left to complete on its own.
+    if (sqe != nullptr) {
+      detail::IOUring::prep_cancel(sqe, reinterpret_cast<std::uint64_t>(operation));
+      sqe->user_data = 0;
+    }
+  }
+  _io_uring->submit();
+  return queued;
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::unlink_uring_operation(detail::UringOperation& operation) noexcept {
+  if (operation.prev != nullptr) {
+    operation.prev->next = operation.next;
+  } else {
+    operation.state->uring_operations = operation.next;
+  }
+  if (operation.next != nullptr) {
+    operation.next->prev = operation.prev;
+  }
+  operation.state = nullptr;
+  operation.prev = nullptr;
+  operation.next = nullptr;
+}
+#endif
+
+template <concepts::executor Executor>
+void IOService<Executor>::wake_scheduler() noexcept {
+  _scheduler_event_fd.trigger();
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::resume_handles() {
+  if constexpr (concepts::batch_executor<Executor>) {
+    _executor->resume_batch(_handles_to_resume);
+  } else {
+    for (auto handle : _handles_to_resume) {
+      _executor->resume(handle);
+    }
+  }
+  _handles_to_resume.clear();
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::submit_timer(detail::TimerOperation& operation) noexcept {
+  _awaiting_size.fetch_add(1, std::memory_order_release);
+  if (_pending_timers.push(&operation)) {
+    wake_scheduler();
+  }
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::arm_pending_timers() {
+  for (auto* timer = _pending_timers.take_all(); timer != nullptr;) {
+    auto* next = timer->next_pending;
+    arm_timer(*timer);
+    timer = next;
+  }
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::arm_timer(detail::TimerOperation& operation) {
+  if (auto* state = operation.state) {
+    // only the io thread takes waiters, so the state cannot change under us here.
+    if (!state->add_waiter(operation.poll_type, operation)) {
+      _awaiting_size.fetch_sub(1, std::memory_order_release);
+      _handles_to_resume.push_back(operation.handle);
+      return;
+    }
+    state->set_timer(operation.poll_type, &operation);
+  }
+  _timer_wheel.add(operation, operation.expiry);
+}
+
+template <concepts::executor Executor>
+void IOService<Executor>::expire_timer(detail::TimerNode& node) {
+  auto& operation = static_cast<detail::TimerOperation&>(node);
+  if (auto* state = operation.state) {
+    state->set_timer(operation.poll_type, nullptr);
+    if (!state->remove_waiter(operation.poll_type, operation)) {
+      return;
+    }
+    operation.timed_out = true;
+  }
+  _awaiting_size.fetch_sub(1, std::memory_order_release);
+  _handles_to_resume.push_back(operation.handle);
+}
+
+template <concepts::executor Executor>
+int IOService<Executor>::next_timeout() const noexcept {
+  auto expiry = _timer_wheel.next_expiry();
+  if (!expiry) {
+    return -1;
+  }
+  auto remaining = std::chrono::ceil<std::chrono::milliseconds>(*expiry - clock::now()).count();
+  return static_cast<int>(std::clamp<decltype(remaining)>(remaining, 0, INT_MAX));
+}
+
 template <concepts::executor Executor>
 void IOService<Executor>::process_scheduled_tasks() {
-  std::vector<std::coroutine_handle<>> coroutines;
-  {
-    std::scoped_lock lock(_awaiting_coroutines_mutex);
-    coroutines.swap(_awaiting_coroutines);
+  // reset before draining: a push that finds a list empty after the exchange triggers again.
+  _scheduler_event_fd.reset();
 
-    _scheduler_event_fd.reset();
-    _scheduler_event_fd_triggered.store(false, std::memory_order_release);
+  arm_pending_timers();
+#ifdef LIBCORO_IO_URING
+  if (_io_uring && _has_queued_uring.load(std::memory_order_acquire)) {
+    std::scoped_lock lock(_io_uring_mutex);
+    submit_queued_uring_operations();
   }
-  for (auto coroutine : coroutines) {
-    _executor->resume(coroutine);
+#endif
+
+  // resumed together with this round's io completions.
+  std::size_t resumed = 0;
+  for (auto* awaiter = _scheduled.take_all(); awaiter != nullptr; ++resumed) {
+    // the awaiter lives in the coroutine frame, it's gone once the coroutine runs.
+    auto* next = awaiter->_next;
+    _handles_to_resume.push_back(awaiter->_handle);
+    awaiter = next;
   }
-  _awaiting_size.fetch_sub(coroutines.size(), std::memory_order_release);
+  _awaiting_size.fetch_sub(resumed, std::memory_order_release);
 }
 } // namespace libcoro
 
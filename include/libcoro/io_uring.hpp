@@ -0,0 +1,116 @@
+#ifndef IO_URING_HPP
+#define IO_URING_HPP
+
+#ifdef LIBCORO_IO_URING
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+namespace libcoro {
+namespace detail {
+// Thin wrapper over the raw io_uring system calls, no liburing needed. Not thread safe: the
+// IOService serialises submissions and only reaps completions on its io thread.
+class IOUring {
+public:
+  explicit IOUring(unsigned entries = 256);
+  ~IOUring();
+
+  IOUring(const IOUring&) = delete;
+  IOUring& operator=(const IOUring&) = delete;
+  IOUring(IOUring&&) = delete;
+  IOUring& operator=(IOUring&&) = delete;
+
+  // whether the running kernel lets us create a ring at all.
+  static bool supported() noexcept;
+
+  // the ring fd turns readable when completions are waiting, so it can sit in an epoll set.
+  int fd() const noexcept { return _ring_fd; }
+
+  // free submission queue entries.
+  unsigned available() const noexcept;
+  // returns nullptr when the submission queue is full, the entry is zeroed.
+  struct io_uring_sqe* get_sqe() noexcept;
+  // hands every prepared entry to the kernel, returns the number submitted or -errno.
+  int submit() noexcept;
+
+  // calls `f(user_data, res, flags)` for every completion that is ready, returns how many.
+  template <typename F>
+  unsigned for_each_completion(F&& f);
+
+  static void prep_recv(struct io_uring_sqe* sqe, int fd, void* buffer, std::size_t size,
+                        int flags) noexcept;
+  static void prep_send(struct io_uring_sqe* sqe, int fd, const void* buffer, std::size_t size,
+                        int flags) noexcept;
+  static void prep_recvmsg(struct io_uring_sqe* sqe, int fd, struct msghdr* msg,
+                           int flags) noexcept;
+  static void prep_sendmsg(struct io_uring_sqe* sqe, int fd, const struct msghdr* msg,
+                           int flags) noexcept;
+  // offset -1 reads or writes at the current file position.
+  static void prep_read(struct io_uring_sqe* sqe, int fd, void* buffer, std::size_t size,
+                        ::off_t offset) noexcept;
+  static void prep_write(struct io_uring_sqe* sqe, int fd, const void* buffer, std::size_t size,
+                         ::off_t offset) noexcept;
+  static void prep_connect(struct io_uring_sqe* sqe, int fd, const struct sockaddr* addr,
+                           socklen_t addr_len) noexcept;
+  // cancels the in-flight entry submitted with `user_data`, which completes with -ECANCELED.
+  static void prep_cancel(struct io_uring_sqe* sqe, std::uint64_t user_data) noexcept;
+  // must directly follow an entry flagged with IOSQE_IO_LINK, cancels it on expiry.
+  static void prep_link_timeout(struct io_uring_sqe* sqe,
+                                struct __kernel_timespec* timeout) noexcept;
+
+private:
+  void release() noexcept;
+  static void prep_rw(int op, struct io_uring_sqe* sqe, int fd, const void* addr, unsigned len,
+                      std::uint64_t offset) noexcept;
+
+  int _ring_fd{-1};
+  unsigned _entries{0};
+
+  void* _sq_ring{nullptr};
+  std::size_t _sq_ring_size{0};
+  void* _cq_ring{nullptr};
+  std::size_t _cq_ring_size{0};
+  struct io_uring_sqe* _sqes{nullptr};
+  std::size_t _sqes_size{0};
+
+  unsigned* _sq_head{nullptr};
+  unsigned* _sq_tail{nullptr};
+  unsigned* _sq_mask{nullptr};
+  unsigned* _sq_array{nullptr};
+  unsigned _sqe_tail{0};
+  unsigned _to_submit{0};
+
+  unsigned* _cq_head{nullptr};
+  unsigned* _cq_tail{nullptr};
+  unsigned* _cq_mask{nullptr};
+  struct io_uring_cqe* _cqes{nullptr};
+};
+
+template <typename F>
+unsigned IOUring::for_each_completion(F&& f) {
+  std::atomic_ref<unsigned> cq_head(*_cq_head);
+  std::atomic_ref<unsigned> cq_tail(*_cq_tail);
+
+  unsigned head = cq_head.load(std::memory_order_relaxed);
+  unsigned tail = cq_tail.load(std::memory_order_acquire);
+  unsigned count = 0;
+  while (head != tail) {
+    auto& cqe = _cqes[head & *_cq_mask];
+    f(cqe.user_data, cqe.res, cqe.flags);
+    ++head;
+    ++count;
+  }
+  cq_head.store(head, std::memory_order_release);
+  return count;
+}
+} // namespace detail
+} // namespace libcoro
+
+#endif // LIBCORO_IO_URING
+
+#endif // !IO_URING_HPP
@@ -1,6 +1,7 @@
 #ifndef IP_ADDRESS_HPP
 #define IP_ADDRESS_HPP
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <array>
 #include <span>
@@ -60,6 +61,17 @@ public:
     return ip;
   }
 
+  // only the bytes of the address family take part.
+  friend bool operator==(const IPAddress& lhs, const IPAddress& rhs) noexcept {
+    return lhs._family == rhs._family && std::ranges::equal(lhs.address(), rhs.address());
+  }
+  friend bool operator<(const IPAddress& lhs, const IPAddress& rhs) noexcept {
+    if (lhs._family != rhs._family) {
+      return lhs._family < rhs._family;
+    }
+    return std::ranges::lexicographical_compare(lhs.address(), rhs.address());
+  }
+
 private:
   Family _family;
   std::array<std::uint8_t, 16> _address;
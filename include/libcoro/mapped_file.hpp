@@ -0,0 +1,138 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include "concepts/executor.hpp"
+#include "libcoro/io_service.hpp"
+#include "libcoro/task.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <fcntl.h>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace libcoro {
+namespace file {
+// mappings at least this large ask for transparent huge pages, fewer tlb misses on scans.
+constexpr std::size_t HUGEPAGE_THRESHOLD = 2 * 1024 * 1024;
+} // namespace file
+
+namespace detail {
+// maps `size` bytes of `fd` read only, nullptr with errno set on failure.
+const char* map_readonly(int fd, std::size_t size) noexcept;
+void unmap(const char* data, std::size_t size) noexcept;
+// brings [offset, offset + length) of a mapping of `fd` into memory and blocks until it is
+// there. only a hint, the result is that of the last madvise.
+int prefetch_mapping(int fd, const char* data, std::size_t offset, std::size_t length) noexcept;
+} // namespace detail
+
+// A read only mapping of a whole file. Views point straight into the page cache, so reading warm
+// data costs no syscall and no copy. Touching a cold page blocks the thread on a page fault;
+// prefetch() pulls ranges in on the blocking pool first so executors never wait for the disk.
+// The file is expected not to shrink while mapped, accessing truncated pages raises SIGBUS.
+template <concepts::executor Executor>
+class MappedFile {
+  using io_service_ptr = std::shared_ptr<IOService<Executor>>;
+
+public:
+  // takes ownership of `fd`.
+  MappedFile(io_service_ptr& io_service, int fd);
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept
+      : _fd(std::exchange(other._fd, -1)), _data(std::exchange(other._data, nullptr)),
+        _size(std::exchange(other._size, 0)), _io_service(std::move(other._io_service)) {}
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+      close();
+      _fd = std::exchange(other._fd, -1);
+      _data = std::exchange(other._data, nullptr);
+      _size = std::exchange(other._size, 0);
+      _io_service = std::move(other._io_service);
+    }
+    return *this;
+  }
+
+  ~MappedFile() { close(); }
+
+  std::span<const char> data() const noexcept { return std::span<const char>(_data, _size); }
+  std::size_t size() const noexcept { return _size; }
+
+  // clamped to the end of the file.
+  std::span<const char> view(std::size_t offset, std::size_t length) const noexcept {
+    offset = std::min(offset, _size);
+    return std::span<const char>(_data + offset, std::min(length, _size - offset));
+  }
+
+  // `range` is a view of this file, e.g. view(offset, length) or data().
+  Task<> prefetch(std::span<const char> range);
+
+  void close();
+
+private:
+  int _fd;
+  const char* _data{nullptr};
+  std::size_t _size{0};
+  io_service_ptr _io_service;
+};
+
+template <concepts::executor Executor>
+MappedFile<Executor>::MappedFile(io_service_ptr& io_service, int fd)
+    : _fd(fd), _io_service(io_service) {
+  struct stat status {};
+  if (::fstat(_fd, &status) == -1) {
+    close();
+    throw std::runtime_error("Failed to get file size");
+  }
+
+  _size = static_cast<std::size_t>(status.st_size);
+  // empty files cannot be mapped, they get empty views instead.
+  if (_size != 0) {
+    _data = detail::map_readonly(_fd, _size);
+    if (_data == nullptr) {
+      close();
+      throw std::runtime_error("Failed to map file");
+    }
+  }
+}
+
+template <concepts::executor Executor>
+Task<> MappedFile<Executor>::prefetch(std::span<const char> range) {
+  if (range.empty()) {
+    co_return;
+  }
+  auto offset = static_cast<std::size_t>(range.data() - _data);
+  co_await _io_service->offload([fd = _fd, data = _data, offset, length = range.size()]() {
+    return detail::prefetch_mapping(fd, data, offset, length);
+  });
+}
+
+template <concepts::executor Executor>
+void MappedFile<Executor>::close() {
+  if (_data != nullptr) {
+    detail::unmap(_data, _size);
+    _data = nullptr;
+  }
+  _size = 0;
+  if (_fd != -1) {
+    ::close(_fd);
+    _fd = -1;
+  }
+}
+
+template <concepts::executor Executor>
+MappedFile<Executor> map_file(std::shared_ptr<IOService<Executor>> io_service, const char* path) {
+  auto fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    throw std::runtime_error("Failed to open file");
+  }
+  return MappedFile<Executor>(io_service, fd);
+}
+} // namespace libcoro
+
+#endif // !MAPPED_FILE_HPP
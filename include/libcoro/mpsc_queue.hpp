@@ -0,0 +1,83 @@
+#ifndef MPSC_QUEUE_HPP
+#define MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+namespace libcoro {
+namespace detail {
+// Bounded lock-free queue for many producers and a single consumer, based on Dmitry Vyukov's
+// bounded MPMC queue. Every cell carries a sequence number telling producers and the consumer
+// whose turn it is, so neither side needs a lock. try_push fails instead of blocking when full.
+template <typename T>
+class MpscQueue {
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T item;
+  };
+
+public:
+  explicit MpscQueue(std::size_t capacity = 1024)
+      : _mask(capacity - 1), _cells(std::make_unique<Cell[]>(capacity)) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+      throw std::invalid_argument("MpscQueue capacity must be a power of two");
+    }
+    for (std::size_t i = 0; i < capacity; ++i) {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+  MpscQueue(MpscQueue&&) = delete;
+  MpscQueue& operator=(MpscQueue&&) = delete;
+
+  // any thread
+  bool try_push(T item) noexcept {
+    auto pos = _tail.load(std::memory_order_relaxed);
+    while (true) {
+      auto& cell = _cells[pos & _mask];
+      auto sequence = cell.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.item = item;
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = _tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // consumer only
+  std::optional<T> try_pop() noexcept {
+    auto& cell = _cells[_head & _mask];
+    auto sequence = cell.sequence.load(std::memory_order_acquire);
+    if (static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(_head + 1) < 0) {
+      return std::nullopt;
+    }
+
+    T item = cell.item;
+    cell.sequence.store(_head + _mask + 1, std::memory_order_release);
+    ++_head;
+    return item;
+  }
+
+private:
+  const std::size_t _mask;
+  std::unique_ptr<Cell[]> _cells;
+
+  alignas(64) std::atomic<std::size_t> _tail{0};
+  alignas(64) std::size_t _head{0};
+};
+} // namespace detail
+} // namespace libcoro
+
+#endif // !MPSC_QUEUE_HPP
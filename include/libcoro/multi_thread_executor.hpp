@@ -1,11 +1,18 @@
 #ifndef MULTI_THREAD_EXECOTOR_HPP
 #define MULTI_THREAD_EXECOTOR_HPP
 
+#include "libcoro/work_stealing_queue.hpp"
+#include <atomic>
 #include <condition_variable>
 #include <coroutine>
+#include <cstdint>
 #include <deque>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <thread>
+#include <vector>
 
 namespace libcoro {
 class MultiThreadExecutor {
@@ -38,19 +45,44 @@ public:
 
   Awaiter start();
   void resume(std::coroutine_handle<> handle);
+  void resume_batch(std::span<std::coroutine_handle<>> handles);
   void shutdown();
 
+  std::size_t size() const noexcept { return _workers.size(); }
+
 private:
+  // every worker owns a local run queue, other workers steal from the top of it when idle.
+  // handles woken from inside a worker go to its `next` slot first and run as soon as the
+  // current coroutine yields, the slot is not visible to stealers.
+  struct Worker {
+    detail::WorkStealingQueue<std::coroutine_handle<>> queue{};
+    std::coroutine_handle<> next{nullptr};
+    std::uint32_t next_runs{0};
+    std::uint32_t tick{0};
+    std::uint64_t steal_seed{0};
+  };
+
   void execute(std::coroutine_handle<> handle);
   void thread_function(std::size_t idx);
 
+  std::optional<std::coroutine_handle<>> next_handle(std::size_t idx);
+  std::optional<std::coroutine_handle<>> pop_global(std::size_t idx);
+  std::optional<std::coroutine_handle<>> steal(std::size_t idx);
+  void wake_idle_workers(std::size_t count = 1);
+
   std::vector<std::thread> _threads{};
+  std::vector<std::unique_ptr<Worker>> _workers{};
+
+  // handles pushed but not yet picked up by a worker.
+  std::atomic<std::int64_t> _size{0};
 
-  std::atomic<std::size_t> _size{0};
-  std::deque<std::coroutine_handle<>> _handles{};
+  // injection queue for handles submitted from outside of the worker threads.
+  std::mutex _global_mutex{};
+  std::deque<std::coroutine_handle<>> _global_handles{};
 
   std::mutex _wait_mutex{};
   std::condition_variable _wait_cv{};
+  std::atomic<std::size_t> _idle_workers{0};
 
   std::atomic<bool> _shutdown_requested{false};
 };
@@ -0,0 +1,83 @@
+#ifndef OUTPUT_QUEUE_HPP
+#define OUTPUT_QUEUE_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace libcoro {
+namespace detail {
+// Bytes sent on a coalescing socket that the io thread has not written yet. Senders append, the
+// io thread writes everything that piled up with a single syscall before it waits for events
+// again, and picks up the rest on the next write readiness when the socket could not take it all.
+class OutputQueue {
+public:
+  enum class AppendResult {
+    QUEUED,
+    // queued, and the io thread has to be asked for a flush.
+    FLUSH_NEEDED,
+    FULL,
+  };
+
+  OutputQueue(int fd, std::size_t limit) noexcept: _fd(fd), _limit(limit) {}
+
+  OutputQueue(const OutputQueue&) = delete;
+  OutputQueue& operator=(const OutputQueue&) = delete;
+  OutputQueue(OutputQueue&&) = delete;
+  OutputQueue& operator=(OutputQueue&&) = delete;
+
+  AppendResult append(std::span<const char> data);
+  // the errno of a failed flush, once. 0 when there was none.
+  int take_error() noexcept;
+
+  // io thread only. writes as much as the socket takes without blocking.
+  void flush() noexcept;
+  // on close: a last non-blocking write, whatever does not fit is dropped.
+  void close() noexcept;
+
+  std::size_t size() const;
+
+  // link in the io service's list of queues waiting for a flush.
+  OutputQueue* next_pending{nullptr};
+  // link in the running turn's list of held back flush requests, and how to make the request
+  // once the turn ends.
+  OutputQueue* next_corked{nullptr};
+  void (*request_flush)(void* context, OutputQueue& output) noexcept {nullptr};
+  void* request_context{nullptr};
+
+private:
+  // with _mutex held.
+  void write_out() noexcept;
+
+  mutable std::mutex _mutex{};
+  int _fd;
+  std::size_t _limit;
+  std::vector<char> _buffer{};
+  bool _flush_requested{false};
+  bool _closed{false};
+  int _error{0};
+};
+
+// Held by executors while a resumed coroutine runs. Flush requests made on the thread in the
+// meantime are held back until the turn ends, so everything the coroutine sends before it
+// suspends again goes out with a single write.
+class OutputCork {
+public:
+  OutputCork() noexcept;
+  ~OutputCork();
+
+  OutputCork(const OutputCork&) = delete;
+  OutputCork& operator=(const OutputCork&) = delete;
+  OutputCork(OutputCork&&) = delete;
+  OutputCork& operator=(OutputCork&&) = delete;
+
+  // false when no turn runs on this thread, the request has to be made right away then.
+  static bool hold(OutputQueue& output) noexcept;
+  // drops a held request, for queues closed before the turn ends.
+  static void release(OutputQueue& output) noexcept;
+};
+} // namespace detail
+} // namespace libcoro
+
+#endif // !OUTPUT_QUEUE_HPP
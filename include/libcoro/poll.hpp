@@ -1,8 +1,12 @@
 #ifndef POLL_HPP
 #define POLL_HPP
 
+#include "libcoro/output_queue.hpp"
+#include "libcoro/timer_wheel.hpp"
 #include <atomic>
 #include <coroutine>
+#include <cstdint>
+#include <memory>
 
 #ifdef __APPLE__
 #include <sys/event.h>
@@ -77,6 +81,215 @@ private:
   bool _processed{false};
 };
 
+struct UringOperation;
+
+// A coroutine parked on an FdState. The io thread stores the status before resuming it, so the
+// waiter never has to look at a record that was retired and freed in the meantime.
+struct FdWaiter {
+  std::coroutine_handle<> handle{nullptr};
+  PollStatus status{PollStatus::EVENT_READY};
+};
+
+// Readiness record of an fd registered once, edge-triggered, for its whole lifetime. The io thread
+// marks a direction ready and wakes its waiter; an operation that hits EAGAIN clears the ready
+// bit again. Every readiness word is `tick << 1 | ready`, the tick is bumped on each event so a
+// stale EAGAIN cannot clear a readiness that arrived after the syscall.
+class FdState {
+public:
+  explicit FdState(int fd) noexcept: _fd(fd) {}
+
+  FdState(const FdState&) = delete;
+  FdState& operator=(const FdState&) = delete;
+  FdState(FdState&&) = delete;
+  FdState& operator=(FdState&&) = delete;
+
+  int fd() const noexcept { return _fd; }
+
+  static bool is_ready(std::uint64_t readiness) noexcept { return readiness & 1; }
+
+  std::uint64_t readiness(PollType poll_type) const noexcept {
+    return direction(poll_type).readiness.load(std::memory_order_acquire);
+  }
+
+  // io thread only
+  void set_ready(PollType poll_type) noexcept {
+    auto& state = direction(poll_type);
+    auto readiness = state.readiness.load(std::memory_order_relaxed);
+    while (!state.readiness.compare_exchange_weak(readiness, ((readiness | 1) + 2),
+                                                  std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed)) {
+    }
+  }
+
+  // returns false when new readiness arrived since `readiness` was observed.
+  bool clear_ready(PollType poll_type, std::uint64_t readiness) noexcept {
+    return direction(poll_type).readiness.compare_exchange_strong(
+        readiness, readiness & ~std::uint64_t{1}, std::memory_order_acq_rel,
+        std::memory_order_relaxed);
+  }
+
+  // io thread only
+  void set_error() noexcept { _error.store(true, std::memory_order_seq_cst); }
+  void set_hangup(PollType poll_type) noexcept {
+    direction(poll_type).hangup.store(true, std::memory_order_seq_cst);
+  }
+
+  // by the owner, for a hangup that no longer holds: an unconnected TCP socket reports one until
+  // connect() starts.
+  void clear_hangup(PollType poll_type) noexcept {
+    direction(poll_type).hangup.store(false, std::memory_order_seq_cst);
+  }
+
+  // set by the owner when it deregisters the fd, every wait from then on ends with EVENT_CLOSED.
+  void set_closed() noexcept { _closed.store(true, std::memory_order_seq_cst); }
+  bool closed() const noexcept { return _closed.load(std::memory_order_acquire); }
+
+  PollStatus status(PollType poll_type) const noexcept {
+    if (_closed.load(std::memory_order_acquire)) {
+      return PollStatus::EVENT_CLOSED;
+    }
+    if (_error.load(std::memory_order_acquire)) {
+      return PollStatus::EVENT_ERROR;
+    }
+    if (direction(poll_type).hangup.load(std::memory_order_acquire)) {
+      return PollStatus::EVENT_CLOSED;
+    }
+    return PollStatus::EVENT_READY;
+  }
+
+  bool can_proceed(PollType poll_type) const noexcept {
+    auto& state = direction(poll_type);
+    return is_ready(state.readiness.load(std::memory_order_seq_cst)) ||
+           state.hangup.load(std::memory_order_seq_cst) ||
+           _error.load(std::memory_order_seq_cst) || _closed.load(std::memory_order_seq_cst);
+  }
+
+  // returns false when the fd turned ready meanwhile and the waiter was not parked.
+  // `waiter.status` is set when it was not parked.
+  bool add_waiter(PollType poll_type, FdWaiter& waiter) noexcept {
+    auto& state = direction(poll_type);
+    state.waiter.store(&waiter, std::memory_order_seq_cst);
+    if (can_proceed(poll_type)) {
+      FdWaiter* expected = &waiter;
+      if (state.waiter.compare_exchange_strong(expected, nullptr, std::memory_order_seq_cst)) {
+        waiter.status = status(poll_type);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool has_waiter() const noexcept {
+    return _read.waiter.load(std::memory_order_seq_cst) != nullptr ||
+           _write.waiter.load(std::memory_order_seq_cst) != nullptr;
+  }
+
+  // io thread only, returns nullptr when nobody waits.
+  FdWaiter* take_waiter(PollType poll_type) noexcept {
+    return direction(poll_type).waiter.exchange(nullptr, std::memory_order_seq_cst);
+  }
+
+  // io thread only, takes the waiter back when its timeout fired first.
+  bool remove_waiter(PollType poll_type, FdWaiter& waiter) noexcept {
+    FdWaiter* expected = &waiter;
+    return direction(poll_type).waiter.compare_exchange_strong(expected, nullptr,
+                                                               std::memory_order_seq_cst);
+  }
+
+  // io thread only, the timeout guarding the current waiter, if any.
+  TimerNode* timer(PollType poll_type) const noexcept { return direction(poll_type).timer; }
+  void set_timer(PollType poll_type, TimerNode* timer) noexcept {
+    direction(poll_type).timer = timer;
+  }
+
+  // MSG_ZEROCOPY sends are numbered by the kernel, the io thread records up to where they have
+  // been released. one sender waits at a time.
+  void enable_zerocopy() noexcept { _zerocopy.store(true, std::memory_order_release); }
+  bool zerocopy() const noexcept { return _zerocopy.load(std::memory_order_acquire); }
+
+  bool zerocopy_released(std::uint32_t sequence) const noexcept {
+    auto released = _zerocopy_released.load(std::memory_order_seq_cst);
+    return static_cast<std::int32_t>(released - sequence) > 0;
+  }
+
+  // io thread only
+  void release_zerocopy(std::uint32_t released) noexcept {
+    _zerocopy_released.store(released, std::memory_order_seq_cst);
+  }
+
+  // returns false when the send was released meanwhile and the waiter was not parked.
+  bool add_zerocopy_waiter(std::coroutine_handle<> waiting_coroutine,
+                           std::uint32_t sequence) noexcept {
+    _zerocopy_sequence = sequence;
+    _zerocopy_waiter.store(waiting_coroutine.address(), std::memory_order_seq_cst);
+    if (zerocopy_released(sequence)) {
+      void* expected = waiting_coroutine.address();
+      if (_zerocopy_waiter.compare_exchange_strong(expected, nullptr,
+                                                   std::memory_order_seq_cst)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // io thread only, returns the waiter once its send has been released.
+  std::coroutine_handle<> take_zerocopy_waiter() noexcept {
+    auto* address = _zerocopy_waiter.load(std::memory_order_seq_cst);
+    if (address == nullptr || !zerocopy_released(_zerocopy_sequence) ||
+        !_zerocopy_waiter.compare_exchange_strong(address, nullptr, std::memory_order_seq_cst)) {
+      return nullptr;
+    }
+    return std::coroutine_handle<>::from_address(address);
+  }
+
+  // coalescing sockets get an output queue, set up once by the owner before the first send.
+  OutputQueue& enable_output_queue(std::size_t limit) {
+    if (!_output) {
+      _output = std::make_unique<OutputQueue>(_fd, limit);
+      _coalescing.store(true, std::memory_order_release);
+    }
+    return *_output;
+  }
+  OutputQueue* output() const noexcept {
+    return _coalescing.load(std::memory_order_acquire) ? _output.get() : nullptr;
+  }
+
+  // io_uring operations in flight on the fd, cancelled when it is deregistered. guarded by the
+  // service's ring lock.
+  UringOperation* uring_operations{nullptr};
+
+private:
+  struct Direction {
+    std::atomic<std::uint64_t> readiness{0};
+    std::atomic<FdWaiter*> waiter{nullptr};
+    std::atomic<bool> hangup{false};
+    TimerNode* timer{nullptr};
+  };
+
+  Direction& direction(PollType poll_type) noexcept {
+    return poll_type == PollType::WRITE ? _write : _read;
+  }
+  const Direction& direction(PollType poll_type) const noexcept {
+    return poll_type == PollType::WRITE ? _write : _read;
+  }
+
+  int _fd{-1};
+  Direction _read{};
+  Direction _write{};
+  std::atomic<bool> _error{false};
+  std::atomic<bool> _closed{false};
+
+  std::atomic<bool> _zerocopy{false};
+  std::atomic<std::uint32_t> _zerocopy_released{0};
+  std::atomic<void*> _zerocopy_waiter{nullptr};
+  // published by the store to _zerocopy_waiter.
+  std::uint32_t _zerocopy_sequence{0};
+
+  // published by the store to _coalescing.
+  std::unique_ptr<OutputQueue> _output{nullptr};
+  std::atomic<bool> _coalescing{false};
+};
+
 } // namespace detail
 } // namespace libcoro
 
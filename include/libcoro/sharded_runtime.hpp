@@ -0,0 +1,56 @@
+#ifndef SHARDED_RUNTIME_HPP
+#define SHARDED_RUNTIME_HPP
+
+#include "libcoro/io_service.hpp"
+#include "libcoro/ip_address.hpp"
+#include "libcoro/single_thread_executor.hpp"
+#include "libcoro/socket.hpp"
+#include "libcoro/task.hpp"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace libcoro {
+// Thread-per-core runtime: every shard owns an IOService with its own poll instance and a
+// SingleThreadExecutor, pinned to a pair of neighbouring cpus. A coroutine started on a shard and
+// every socket created for it stay on that shard.
+class ShardedRuntime {
+public:
+  using executor_type = SingleThreadExecutor;
+  using io_service_ptr = std::shared_ptr<IOService<executor_type>>;
+
+  explicit ShardedRuntime(std::size_t shards = detail::cpu_count(), bool pin_threads = true);
+  ~ShardedRuntime();
+
+  ShardedRuntime(const ShardedRuntime&) = delete;
+  ShardedRuntime& operator=(const ShardedRuntime&) = delete;
+  ShardedRuntime(ShardedRuntime&&) = delete;
+  ShardedRuntime& operator=(ShardedRuntime&&) = delete;
+
+  std::size_t size() const noexcept { return _shards.size(); }
+  io_service_ptr& shard(std::size_t idx) { return _shards.at(idx); }
+  // shards handed out round-robin, for spreading outbound work.
+  io_service_ptr& next_shard() noexcept {
+    return _shards[_next.fetch_add(1, std::memory_order_relaxed) % _shards.size()];
+  }
+
+  void spawn(std::size_t idx, Task<void>&& task) { shard(idx)->execute(std::move(task)); }
+  void close();
+
+private:
+  std::vector<io_service_ptr> _shards{};
+  std::atomic<std::size_t> _next{0};
+};
+
+// one socket per shard, all with SO_REUSEPORT set. bind and listen each of them on the same
+// address and the kernel spreads incoming connections across the shards.
+std::vector<Socket<ShardedRuntime::executor_type>>
+create_socket(ShardedRuntime& runtime, socket::Family family, socket::Protocol protocol);
+
+// create_socket, bind and listen in one go. port 0 binds every shard to the same free port.
+std::vector<Socket<ShardedRuntime::executor_type>>
+create_listener(ShardedRuntime& runtime, socket::Family family, socket::Protocol protocol,
+                const socket::IPAddress& address, int port, int backlog = SOMAXCONN);
+} // namespace libcoro
+
+#endif // !SHARDED_RUNTIME_HPP
@@ -1,15 +1,21 @@
 #ifndef SINGLE_THREAD_EXECUTOR_HPP
 #define SINGLE_THREAD_EXECUTOR_HPP
 
-#include <condition_variable>
+#include "libcoro/mpsc_queue.hpp"
+#include <atomic>
 #include <coroutine>
+#include <cstdint>
+#include <deque>
 #include <mutex>
+#include <span>
 #include <thread>
 
 namespace libcoro {
 class SingleThreadExecutor {
 public:
   SingleThreadExecutor();
+  // pin the executor thread to `cpu`.
+  explicit SingleThreadExecutor(std::size_t cpu);
   ~SingleThreadExecutor();
 
   SingleThreadExecutor(const SingleThreadExecutor&) = delete;
@@ -38,17 +44,35 @@ public:
 
   Awaiter start() { return Awaiter{*this}; }
   void resume(std::coroutine_handle<>);
+  void resume_batch(std::span<std::coroutine_handle<>> handles);
 
 private:
   void execute(std::coroutine_handle<> handle);
+  // queues without signalling, returns false when called from the executor thread.
+  bool enqueue(std::coroutine_handle<> handle);
+  void wake(std::int64_t count);
   void background_thread();
+  std::size_t drain();
+  void park();
 
-  std::coroutine_handle<> _handle{nullptr};
   std::atomic<bool> _shutdown_requested{false};
 
+  // handles resumed from other threads.
+  detail::MpscQueue<std::coroutine_handle<>> _handles{};
+  // taken only when the queue above is full.
+  std::mutex _overflow_mutex{};
+  std::deque<std::coroutine_handle<>> _overflow_handles{};
+  std::atomic<bool> _has_overflow{false};
+
+  // handles pushed but not yet resumed, shared with producers to decide whether to sleep.
+  std::atomic<std::int64_t> _pending{0};
+  // set while the executor thread is blocked, producers only signal when it is.
+  std::atomic<bool> _sleeping{false};
+
+  // handles resumed from the executor thread itself, only touched by that thread.
+  std::deque<std::coroutine_handle<>> _local_handles{};
+
   std::thread _execute_thread;
-  std::mutex _wait_mutex{};
-  std::condition_variable _wait_cv{};
 };
 } // namespace libcoro
 
@@ -2,17 +2,34 @@
 #define SOCKET_HPP
 
 #include "concepts/executor.hpp"
+#include "libcoro/async_generator.hpp"
+#include "libcoro/buffer_pool.hpp"
 #include "libcoro/io_service.hpp"
 #include "libcoro/ip_address.hpp"
 #include "libcoro/poll.hpp"
+#include "libcoro/socket_options.hpp"
+#include <algorithm>
 #include <arpa/inet.h>
+#include <array>
 #include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
 #include <fcntl.h>
+#include <pthread.h>
 #include <memory>
 #include <optional>
 #include <span>
+#include <stdexcept>
 #include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 #include <unistd.h>
+#include <utility>
+#include <vector>
 
 namespace libcoro {
 namespace socket {
@@ -49,89 +66,303 @@ enum class Protocol : int {
   TCP = SOCK_STREAM,
   UDP = SOCK_DGRAM,
 };
+
+// buffers handed to the kernel per sendv / recvv call.
+constexpr std::size_t MAX_IO_VECTORS = 64;
+// datagrams moved per send_many / recv_many call.
+constexpr std::size_t MAX_DATAGRAM_BATCH = 32;
+// bytes a coalescing socket queues before send reports OUTPUT_QUEUE_FULL.
+constexpr std::size_t MAX_OUTPUT_QUEUE = 4 * 1024 * 1024;
+// pause before accepting again once the process runs out of descriptors or memory.
+constexpr std::chrono::milliseconds ACCEPT_BACKOFF{10};
 } // namespace socket
 
+namespace detail {
+// sends to a peer that went away fail with EPIPE instead of raising SIGPIPE. the send calls pass
+// MSG_NOSIGNAL, this covers the ones without flags where the platform has a socket option.
+inline void suppress_sigpipe([[maybe_unused]] int fd) noexcept {
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+
+#ifdef __linux__
+// sendfile has no MSG_NOSIGNAL. SIGPIPE stays blocked on the calling thread while this lives, and
+// one raised in the meantime is consumed before the old mask comes back. must not be held across
+// a suspension, the coroutine may resume on another thread.
+class SigpipeBlock {
+public:
+  SigpipeBlock() noexcept {
+    ::sigemptyset(&_sigpipe);
+    ::sigaddset(&_sigpipe, SIGPIPE);
+    sigset_t pending;
+    ::sigpending(&pending);
+    _was_pending = ::sigismember(&pending, SIGPIPE) == 1;
+    ::pthread_sigmask(SIG_BLOCK, &_sigpipe, &_old);
+  }
+  ~SigpipeBlock() {
+    auto error = errno;
+    if (_raised && !_was_pending) {
+      struct timespec zero {};
+      while (::sigtimedwait(&_sigpipe, nullptr, &zero) == -1 && errno == EINTR) {
+      }
+    }
+    ::pthread_sigmask(SIG_SETMASK, &_old, nullptr);
+    errno = error;
+  }
+
+  SigpipeBlock(const SigpipeBlock&) = delete;
+  SigpipeBlock& operator=(const SigpipeBlock&) = delete;
+
+  ::ssize_t sendfile(int out_fd, int in_fd, ::off_t* offset, std::size_t count) noexcept {
+    auto bytes = ::sendfile(out_fd, in_fd, offset, count);
+    if (bytes == -1 && errno == EPIPE) {
+      _raised = true;
+    }
+    return bytes;
+  }
+
+private:
+  sigset_t _sigpipe;
+  sigset_t _old;
+  bool _was_pending{false};
+  bool _raised{false};
+};
+#endif
+} // namespace detail
+
 template <concepts::executor Executor>
 class Socket {
   using io_service_ptr = std::shared_ptr<IOService<Executor>>;
 
 public:
-  Socket(io_service_ptr& io_services, int fd) noexcept: _fd(fd), _io_service(io_services) {}
+  // the fd is registered with the io service once, for the lifetime of the socket.
+  Socket(io_service_ptr& io_services, int fd)
+      : _fd(fd), _io_service(io_services), _state(_io_service->register_fd(fd)) {
+    if (!_state) {
+      throw std::runtime_error("Failed to register socket with the io service");
+    }
+    detail::suppress_sigpipe(_fd);
+  }
 
   Socket(const Socket&) = delete;
   Socket& operator=(const Socket&) = delete;
 
-  Socket(Socket&& other) noexcept = default;
-  Socket& operator=(Socket&& other) noexcept = default;
+  // the moved-from socket is left closed, closing it again is a no-op.
+  Socket(Socket&& other) noexcept
+      : _fd(std::exchange(other._fd, -1)), _io_service(std::move(other._io_service)),
+        _state(std::move(other._state)), _connect_status(other._connect_status),
+        _accept_options(std::move(other._accept_options)),
+        _zerocopy_sequence(other._zerocopy_sequence) {}
+  Socket& operator=(Socket&& other) noexcept {
+    if (this != &other) {
+      close();
+      _fd = std::exchange(other._fd, -1);
+      _io_service = std::move(other._io_service);
+      _state = std::move(other._state);
+      _connect_status = other._connect_status;
+      _accept_options = std::move(other._accept_options);
+      _zerocopy_sequence = other._zerocopy_sequence;
+    }
+    return *this;
+  }
+
+  // deregisters the fd before its readiness record goes away.
+  ~Socket() { close(); }
 
-  Task<detail::PollStatus> poll();
-  Task<detail::PollStatus> poll(detail::PollType);
+  // plain awaiters, waiting for readiness allocates nothing.
+  typename IOService<Executor>::ReadinessAwaiter poll();
+  typename IOService<Executor>::ReadinessAwaiter poll(detail::PollType);
+  typename IOService<Executor>::TimedReadinessAwaiter
+  poll(detail::PollType, std::chrono::steady_clock::duration timeout);
 
   Task<socket::ConnectStatus> connect(const socket::IPAddress& addr, int port);
+  // gives up with ConnectStatus::TIMEOUT when the handshake takes longer than `timeout`.
+  Task<socket::ConnectStatus> connect(const socket::IPAddress& addr, int port,
+                                      std::chrono::steady_clock::duration timeout);
   int bind(int port, const socket::IPAddress& address);
+  int listen(int backlog = SOMAXCONN);
+  // the port the socket is bound to, the one the kernel picked after binding port 0. -1 with
+  // errno set on failure.
+  int local_port() const;
 
-  Socket accept();
-  template <concepts::executor T>
-  Socket<T> accept(std::shared_ptr<IOService<T>> io_service) {
-    struct sockaddr_in client_addr;
-    constexpr const auto client_addr_len = sizeof(client_addr);
+  // returns -1 with errno set when an option could not be applied, like bind and listen.
+  int set_options(const socket::Options& options);
+  // listeners, applied to every socket accept and accept_all hand out from now on. connections
+  // the options cannot be applied to are dropped.
+  void set_accept_options(const socket::Options& options) { _accept_options = options; }
 
-    auto fd =
-        ::accept(_fd, reinterpret_cast<struct sockaddr*>(&client_addr),
-                 const_cast<socklen_t*>(reinterpret_cast<const socklen_t*>(&client_addr_len)));
-
-    if (fd == -1) {
-      throw std::runtime_error("Failed to accept connection");
-    }
+  // waits until a connection is pending, accepted sockets are non-blocking. throws when the
+  // listener fails for good.
+  Task<Socket> accept();
+  template <concepts::executor T>
+  Task<Socket<T>> accept(std::shared_ptr<IOService<T>> io_service);
 
-    return Socket<T>(io_service, fd);
-  }
+  // every incoming connection, in order. each wakeup drains the whole backlog before waiting
+  // again, so a connection storm costs one readiness event instead of one per connection. the
+  // stream ends when the listener is closed or fails.
+  AsyncGenerator<Socket> accept_all();
+  // same, but the accepted sockets are handed round-robin to `io_services`.
+  template <concepts::executor T>
+  AsyncGenerator<Socket<T>> accept_all(std::vector<std::shared_ptr<IOService<T>>> io_services);
 
+  // the returned buffer is malloc'ed and owned by the caller.
   Task<std::pair<socket::TransferStatus, std::span<char>>> recieve(std::size_t size);
   std::pair<socket::TransferStatus, std::span<char>> recieve_sync(std::size_t size);
+  // read into `buffer`, returns the number of bytes received.
+  Task<std::pair<socket::TransferStatus, std::size_t>> recieve(std::span<char> buffer);
+  std::pair<socket::TransferStatus, std::size_t> recieve_sync(std::span<char> buffer);
+  // read into a buffer leased from the io service's pool, the lease is sized to the data.
+  Task<std::pair<socket::TransferStatus, BufferLease>> recieve_pooled(std::size_t size);
 
+  // on a coalescing socket OK only means the data was queued, not that it was written.
   Task<std::pair<socket::TransferStatus, std::size_t>> send(std::span<const char> data);
+  // opt-in corking: from now on send only queues the data and the io service writes what one
+  // executor turn sent with a single syscall. a failed write is reported by the next send.
+  // sendv, send_file and send_zerocopy bypass the queue and must not be mixed with it.
+  void enable_coalescing();
   std::pair<socket::TransferStatus, std::size_t> send_sync(std::span<const char> data);
+  // keeps sending until all of `data` is out or an error occurs, the count says how much went.
+  Task<std::pair<socket::TransferStatus, std::size_t>> send_all(std::span<const char> data);
+
+  // sends `length` bytes of `fd` starting at `offset` with sendfile, the data never passes
+  // through user space. stops early only at the end of the file or on error.
+  Task<std::pair<socket::TransferStatus, std::size_t>> send_file(int fd, ::off_t offset,
+                                                                 std::size_t length);
+
+  // scatter/gather over up to MAX_IO_VECTORS buffers in one syscall. the byte count may fall
+  // short of the total, like send and recieve.
+  Task<std::pair<socket::TransferStatus, std::size_t>>
+  sendv(std::span<const std::span<const char>> buffers);
+  Task<std::pair<socket::TransferStatus, std::size_t>>
+  recvv(std::span<const std::span<char>> buffers);
+
+#ifdef __linux__
+  // opts the socket into MSG_ZEROCOPY, false when the kernel or socket type does not support it.
+  bool enable_zerocopy();
+  // sends without copying `data` into the kernel and resumes only once the kernel has released
+  // the buffer, so it must stay untouched until then. pays off for large payloads only, plain
+  // send is used while zerocopy is not enabled.
+  Task<std::pair<socket::TransferStatus, std::size_t>> send_zerocopy(std::span<const char> data);
+
+  // datagram sockets: up to MAX_DATAGRAM_BATCH datagrams per syscall, returns how many went out.
+  Task<std::pair<socket::TransferStatus, std::size_t>>
+  send_many(std::span<const std::span<const char>> datagrams);
+  // one datagram per buffer, its length goes to the matching entry of `sizes`. returns how many
+  // datagrams arrived.
+  Task<std::pair<socket::TransferStatus, std::size_t>>
+  recv_many(std::span<const std::span<char>> buffers, std::span<std::size_t> sizes);
+#endif
+
+  // non-blocking check for pooled connections: false once the peer has closed it, it failed, or
+  // unread data is waiting that nobody asked for.
+  bool alive() noexcept;
 
   void close();
   bool shutdown(detail::PollType how);
 
 private:
+  // one non-blocking accept with the accept options applied, -1 with errno set like accept(2)
+  // otherwise.
+  int accept_fd() noexcept;
+
+  Task<socket::ConnectStatus>
+  connect_impl(const socket::IPAddress& addr, int port,
+               std::optional<std::chrono::steady_clock::duration> timeout);
+
   int _fd;
   io_service_ptr _io_service;
+  // readiness record, null once the socket is closed or moved from.
+  std::unique_ptr<detail::FdState> _state{nullptr};
 
   std::optional<socket::ConnectStatus> _connect_status{std::nullopt};
+  std::optional<socket::Options> _accept_options{std::nullopt};
+  // the kernel numbers zerocopy sends per socket, starting at zero.
+  std::uint32_t _zerocopy_sequence{0};
 };
 } // namespace libcoro
 
 namespace libcoro {
-// tempararily support only TCP IPv4
-template <concepts::executor Executor>
-inline Socket<Executor> create_socket(std::shared_ptr<IOService<Executor>>& io_service,
-                                      socket::Family family, socket::Protocol protocol) {
+namespace detail {
+inline int create_socket_fd(socket::Family family, socket::Protocol protocol) {
   auto fd = ::socket(static_cast<int>(family), static_cast<int>(protocol), 0);
+  if (fd == -1) {
+    throw std::runtime_error("Failed to create socket");
+  }
   auto flags = fcntl(fd, F_GETFL, 0);
   if (flags == -1) {
+    ::close(fd);
     throw std::runtime_error("Failed to get file flags");
   }
   if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+    ::close(fd);
     throw std::runtime_error("Failed to set file flags");
   }
+  return fd;
+}
+} // namespace detail
+
+// tempararily support only TCP IPv4
+template <concepts::executor Executor>
+inline Socket<Executor> create_socket(std::shared_ptr<IOService<Executor>>& io_service,
+                                      socket::Family family, socket::Protocol protocol) {
+  return Socket(io_service, detail::create_socket_fd(family, protocol));
+}
+
+// options that have to be in place before bind or connect, like reuse_port or the buffer sizes,
+// go here.
+template <concepts::executor Executor>
+inline Socket<Executor> create_socket(std::shared_ptr<IOService<Executor>>& io_service,
+                                      socket::Family family, socket::Protocol protocol,
+                                      const socket::Options& options) {
+  auto fd = detail::create_socket_fd(family, protocol);
+  if (detail::apply_socket_options(fd, options) == -1) {
+    ::close(fd);
+    throw std::runtime_error("Failed to set socket options");
+  }
   return Socket(io_service, fd);
 }
 
 template <concepts::executor Executor>
-Task<detail::PollStatus> Socket<Executor>::poll() {
-  return _io_service->poll(_fd, detail::PollType::READ);
+auto Socket<Executor>::poll() -> typename IOService<Executor>::ReadinessAwaiter {
+  return poll(detail::PollType::READ);
 }
 
 template <concepts::executor Executor>
-Task<detail::PollStatus> Socket<Executor>::poll(detail::PollType poll_type) {
-  return _io_service->poll(_fd, poll_type);
+auto Socket<Executor>::poll(detail::PollType poll_type) ->
+    typename IOService<Executor>::ReadinessAwaiter {
+  if (!_state) {
+    throw std::runtime_error("File descriptor is null");
+  }
+  return _io_service->poll(*_state, poll_type);
+}
+
+template <concepts::executor Executor>
+auto Socket<Executor>::poll(detail::PollType poll_type,
+                            std::chrono::steady_clock::duration timeout) ->
+    typename IOService<Executor>::TimedReadinessAwaiter {
+  if (!_state) {
+    throw std::runtime_error("File descriptor is null");
+  }
+  return _io_service->poll(*_state, poll_type, timeout);
 }
 
 template <concepts::executor Executor>
 Task<socket::ConnectStatus> Socket<Executor>::connect(const socket::IPAddress& addr, int port) {
+  return connect_impl(addr, port, std::nullopt);
+}
+
+template <concepts::executor Executor>
+Task<socket::ConnectStatus> Socket<Executor>::connect(const socket::IPAddress& addr, int port,
+                                                      std::chrono::steady_clock::duration timeout) {
+  return connect_impl(addr, port, timeout);
+}
+
+template <concepts::executor Executor>
+Task<socket::ConnectStatus>
+Socket<Executor>::connect_impl(const socket::IPAddress& addr, int port,
+                               std::optional<std::chrono::steady_clock::duration> timeout) {
   if (_connect_status.has_value()) {
     co_return _connect_status.value();
   }
@@ -141,28 +372,75 @@ Task<socket::ConnectStatus> Socket<Executor>::connect(const socket::IPAddress& a
   server_addr.sin_port = htons(port);
   server_addr.sin_addr = *reinterpret_cast<const struct in_addr*>(addr.address().data());
 
+#ifdef LIBCORO_IO_URING
+  if (_io_service->io_uring_enabled()) {
+    auto prepare = [&](struct io_uring_sqe* sqe) {
+      detail::IOUring::prep_connect(sqe, _fd, reinterpret_cast<struct sockaddr*>(&server_addr),
+                                    sizeof(server_addr));
+    };
+    auto result = timeout ? co_await _io_service->submit(*_state, prepare, *timeout)
+                          : co_await _io_service->submit(*_state, prepare);
+    if (!_state) {
+      // closed while connecting.
+      _connect_status = socket::ConnectStatus::ERROR;
+    } else if (result == 0) {
+      _connect_status = socket::ConnectStatus::CONENCTED;
+    } else if (result == -ETIMEDOUT || result == -ECANCELED) {
+      _connect_status = socket::ConnectStatus::TIMEOUT;
+    } else {
+      _connect_status = socket::ConnectStatus::ERROR;
+    }
+    co_return _connect_status.value();
+  }
+#endif
+
+  // an unconnected socket reports itself writable and hung up, both stale once connect() starts.
+  _state->clear_hangup(detail::PollType::WRITE);
+  _state->clear_ready(detail::PollType::WRITE, _state->readiness(detail::PollType::WRITE));
   auto ret = ::connect(_fd, reinterpret_cast<struct sockaddr*>(&server_addr), sizeof(server_addr));
   if (ret == 0) {
     _connect_status = socket::ConnectStatus::CONENCTED;
     co_return socket::ConnectStatus::CONENCTED;
-  } else if (ret == -1) {
-    if (errno == EINPROGRESS) {
-      auto poll_status = co_await _io_service->poll(_fd, detail::PollType::WRITE);
-      if (poll_status == detail::PollStatus::EVENT_READY) {
-        int result = 0;
-        socklen_t result_len = sizeof(result);
-        if (::getsockopt(_fd, SOL_SOCKET, SO_ERROR, &result, &result_len) == -1) {
-          throw std::runtime_error("Failed to get socket options");
-        }
-        if (result == 0) {
-          _connect_status = socket::ConnectStatus::CONENCTED;
-          co_return socket::ConnectStatus::CONENCTED;
-        }
-        // TODO: poll timeout not supported yet
-      } else if (poll_status == detail::PollStatus::EVENT_TIMEOUT) {
+  } else if (ret == -1 && errno == EINPROGRESS) {
+    auto deadline = std::chrono::steady_clock::now() +
+                    timeout.value_or(std::chrono::steady_clock::duration::zero());
+    while (true) {
+      auto poll_status = detail::PollStatus::EVENT_READY;
+      if (timeout) {
+        auto remaining = std::max(deadline - std::chrono::steady_clock::now(),
+                                  std::chrono::steady_clock::duration::zero());
+        poll_status = co_await poll(detail::PollType::WRITE, remaining);
+      } else {
+        poll_status = co_await poll(detail::PollType::WRITE);
+      }
+      if (poll_status == detail::PollStatus::EVENT_TIMEOUT) {
         _connect_status = socket::ConnectStatus::TIMEOUT;
         co_return socket::ConnectStatus::TIMEOUT;
       }
+      if (!_state || poll_status == detail::PollStatus::EVENT_ERROR) {
+        break;
+      }
+
+      int result = 0;
+      socklen_t result_len = sizeof(result);
+      if (::getsockopt(_fd, SOL_SOCKET, SO_ERROR, &result, &result_len) == -1) {
+        throw std::runtime_error("Failed to get socket options");
+      }
+      if (result != 0) {
+        break;
+      }
+      struct sockaddr_storage peer {};
+      socklen_t peer_len = sizeof(peer);
+      if (::getpeername(_fd, reinterpret_cast<struct sockaddr*>(&peer), &peer_len) == 0) {
+        _connect_status = socket::ConnectStatus::CONENCTED;
+        co_return socket::ConnectStatus::CONENCTED;
+      }
+      if (errno != ENOTCONN) {
+        break;
+      }
+      // an event from before connect() that the io thread only applied now, still connecting.
+      _state->clear_hangup(detail::PollType::WRITE);
+      _state->clear_ready(detail::PollType::WRITE, _state->readiness(detail::PollType::WRITE));
     }
   }
 
@@ -171,43 +449,259 @@ Task<socket::ConnectStatus> Socket<Executor>::connect(const socket::IPAddress& a
 }
 
 template <concepts::executor Executor>
-auto Socket<Executor>::accept() -> Socket {
+int Socket<Executor>::bind(int port, const socket::IPAddress& address) {
+  struct sockaddr_in addr {};
+  addr.sin_family = static_cast<int>(address.family());
+  addr.sin_port = htons(port);
+  addr.sin_addr = *reinterpret_cast<const struct in_addr*>(address.address().data());
+
+  return ::bind(_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+}
+
+template <concepts::executor Executor>
+int Socket<Executor>::listen(int backlog) {
+  return ::listen(_fd, backlog);
+}
+
+template <concepts::executor Executor>
+int Socket<Executor>::local_port() const {
+  struct sockaddr_in addr {};
+  socklen_t addr_len = sizeof(addr);
+  if (::getsockname(_fd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len) == -1) {
+    return -1;
+  }
+  return ntohs(addr.sin_port);
+}
+
+template <concepts::executor Executor>
+int Socket<Executor>::set_options(const socket::Options& options) {
+  return detail::apply_socket_options(_fd, options);
+}
+
+template <concepts::executor Executor>
+int Socket<Executor>::accept_fd() noexcept {
+#ifdef __linux__
+  auto fd = ::accept4(_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+  auto fd = ::accept(_fd, nullptr, nullptr);
+  if (fd != -1) {
+    auto flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1 ||
+        fcntl(fd, F_SETFD, FD_CLOEXEC) == -1) {
+      ::close(fd);
+      return -1;
+    }
+  }
+#endif
+  if (fd != -1 && _accept_options && detail::apply_socket_options(fd, *_accept_options) == -1) {
+    ::close(fd);
+    // retried like a connection that was aborted in the backlog.
+    errno = ECONNABORTED;
+    return -1;
+  }
+  return fd;
+}
+
+namespace detail {
+// the connection died in the backlog or the call was interrupted, the next one may succeed.
+inline bool accept_retry(int error) noexcept {
+  return error == ECONNABORTED || error == EINTR || error == EPROTO;
+}
+
+// out of descriptors or memory, pending connections stay queued until some are freed.
+inline bool accept_exhausted(int error) noexcept {
+  return error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM;
+}
+} // namespace detail
+
+template <concepts::executor Executor>
+auto Socket<Executor>::accept() -> Task<Socket> {
   return accept(_io_service);
 }
 
+template <concepts::executor Executor>
+template <concepts::executor T>
+Task<Socket<T>> Socket<Executor>::accept(std::shared_ptr<IOService<T>> io_service) {
+  if (!_state) {
+    throw std::runtime_error("File descriptor is null");
+  }
+
+  while (true) {
+    auto readiness = _state->readiness(detail::PollType::READ);
+    auto fd = accept_fd();
+    if (fd != -1) {
+      try {
+        co_return Socket<T>(io_service, fd);
+      } catch (...) {
+        // not registered, so the socket never owned it.
+        ::close(fd);
+        throw;
+      }
+    }
+
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      _state->clear_ready(detail::PollType::READ, readiness);
+      co_await _io_service->wait_ready(*_state, detail::PollType::READ);
+      if (!_state) {
+        throw std::runtime_error("Socket closed while accepting");
+      }
+    } else if (detail::accept_exhausted(errno)) {
+      co_await _io_service->sleep_for(socket::ACCEPT_BACKOFF);
+    } else if (!detail::accept_retry(errno)) {
+      throw std::runtime_error("Failed to accept connection");
+    }
+  }
+}
+
+template <concepts::executor Executor>
+auto Socket<Executor>::accept_all() -> AsyncGenerator<Socket> {
+  return accept_all(std::vector<io_service_ptr>{_io_service});
+}
+
+template <concepts::executor Executor>
+template <concepts::executor T>
+AsyncGenerator<Socket<T>>
+Socket<Executor>::accept_all(std::vector<std::shared_ptr<IOService<T>>> io_services) {
+  if (io_services.empty()) {
+    throw std::invalid_argument("accept_all needs at least one io service");
+  }
+
+  std::size_t next = 0;
+  while (_state) {
+    auto readiness = _state->readiness(detail::PollType::READ);
+    auto fd = accept_fd();
+    if (fd != -1) {
+      auto& io_service = io_services[next];
+      next = next + 1 == io_services.size() ? 0 : next + 1;
+      try {
+        co_yield Socket<T>(io_service, fd);
+      } catch (...) {
+        // not registered, so the socket never owned it.
+        ::close(fd);
+        throw;
+      }
+      continue;
+    }
+
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      // backlog drained. closing the listener resumes the wait and ends the stream.
+      _state->clear_ready(detail::PollType::READ, readiness);
+      co_await _io_service->wait_ready(*_state, detail::PollType::READ);
+    } else if (detail::accept_exhausted(errno)) {
+      co_await _io_service->sleep_for(socket::ACCEPT_BACKOFF);
+    } else if (!detail::accept_retry(errno)) {
+      co_return;
+    }
+  }
+}
+
 template <concepts::executor Executor>
 Task<std::pair<socket::TransferStatus, std::span<char>>>
 Socket<Executor>::recieve(std::size_t size) {
+  auto buffer = static_cast<char*>(std::malloc(size));
+  auto [status, bytes] = co_await recieve(std::span<char>(buffer, size));
+  if (status != socket::TransferStatus::OK) {
+    std::free(buffer);
+    co_return {status, std::span<char>()};
+  }
+  co_return {status, std::span<char>(buffer, bytes)};
+}
+
+template <concepts::executor Executor>
+Task<std::pair<socket::TransferStatus, BufferLease>>
+Socket<Executor>::recieve_pooled(std::size_t size) {
+  auto lease = _io_service->buffer_pool().acquire(size);
+  auto [status, bytes] = co_await recieve(lease.span());
+  lease.resize(bytes);
+  co_return {status, std::move(lease)};
+}
+
+template <concepts::executor Executor>
+Task<std::pair<socket::TransferStatus, std::size_t>>
+Socket<Executor>::recieve(std::span<char> buffer) {
   if (_fd == -1) {
     throw std::runtime_error("File descriptor is null");
   }
 
-  co_await _io_service->schedule();
+  // optimistic: on a busy connection the data is usually there already, so the syscall is tried
+  // inline and the coroutine suspends only on EAGAIN. MSG_DONTWAIT keeps the attempt from
+  // blocking on fds that were not opened non-blocking. readiness is observed before every
+  // attempt, so an edge that arrives during the syscall is not lost.
+  auto readiness = _state->readiness(detail::PollType::READ);
+  auto bytes = ::recv(_fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
 
-  auto buffer = std::malloc(size);
-  auto bytes = ::recv(_fd, buffer, size, 0);
+#ifdef LIBCORO_IO_URING
+  if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK) &&
+      _io_service->io_uring_enabled()) {
+    auto result = co_await _io_service->submit(*_state, [&](struct io_uring_sqe* sqe) {
+      detail::IOUring::prep_recv(sqe, _fd, buffer.data(), buffer.size(), 0);
+    });
+    if (!_state) {
+      // closed while in flight, the operation was cancelled.
+      co_return {socket::TransferStatus::CLOSED, 0};
+    }
+    if (result > 0) {
+      co_return {socket::TransferStatus::OK, static_cast<std::size_t>(result)};
+    } else if (result == 0) {
+      co_return {socket::TransferStatus::CLOSED, 0};
+    }
+    co_return {static_cast<socket::TransferStatus>(-result), 0};
+  }
+#endif
+
+  while (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    // nothing buffered, wait for the next edge.
+    _state->clear_ready(detail::PollType::READ, readiness);
+    co_await _io_service->wait_ready(*_state, detail::PollType::READ);
+    if (!_state) {
+      // closed while waiting.
+      errno = EBADF;
+      break;
+    }
+    readiness = _state->readiness(detail::PollType::READ);
+    bytes = ::recv(_fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+  }
 
   if (bytes > 0) {
-    co_return {socket::TransferStatus::OK, std::span<char>(static_cast<char*>(buffer), bytes)};
+    co_return {socket::TransferStatus::OK, static_cast<std::size_t>(bytes)};
   } else if (bytes == 0) {
-    co_return {socket::TransferStatus::CLOSED, std::span<char>()};
+    co_return {socket::TransferStatus::CLOSED, 0};
   } else {
-    co_return {static_cast<socket::TransferStatus>(errno), std::span<char>()};
+    co_return {static_cast<socket::TransferStatus>(errno), 0};
   }
 }
 
 template <concepts::executor Executor>
 std::pair<socket::TransferStatus, std::span<char>>
 Socket<Executor>::recieve_sync(std::size_t size) {
-  auto buffer = std::malloc(size);
-  auto bytes = ::recv(_fd, buffer, size, 0);
+  auto buffer = static_cast<char*>(std::malloc(size));
+  auto [status, bytes] = recieve_sync(std::span<char>(buffer, size));
+  if (status != socket::TransferStatus::OK) {
+    std::free(buffer);
+    return {status, {}};
+  }
+  return {status, std::span<char>(buffer, bytes)};
+}
+
+template <concepts::executor Executor>
+std::pair<socket::TransferStatus, std::size_t>
+Socket<Executor>::recieve_sync(std::span<char> buffer) {
+  auto bytes = ::recv(_fd, buffer.data(), buffer.size(), 0);
   if (bytes > 0) {
-    return {socket::TransferStatus::OK, std::span<char>(static_cast<char*>(buffer), bytes)};
+    return {socket::TransferStatus::OK, static_cast<std::size_t>(bytes)};
   } else if (bytes == 0) {
-    return {socket::TransferStatus::CLOSED, {}};
+    return {socket::TransferStatus::CLOSED, 0};
   } else {
-    return {static_cast<socket::TransferStatus>(errno), {}};
+    return {static_cast<socket::TransferStatus>(errno), 0};
+  }
+}
+
+template <concepts::executor Executor>
+void Socket<Executor>::enable_coalescing() {
+  if (!_state) {
+    throw std::runtime_error("File descriptor is null");
   }
+  _state->enable_output_queue(socket::MAX_OUTPUT_QUEUE);
 }
 
 template <concepts::executor Executor>
@@ -216,8 +710,55 @@ Socket<Executor>::send(std::span<const char> data) {
   if (_fd == -1) {
     throw std::runtime_error("File descriptor is null");
   }
-  co_await _io_service->schedule();
-  auto bytes = ::send(_fd, data.data(), data.size(), 0);
+
+  if (auto* output = _state->output()) {
+    if (auto error = output->take_error()) {
+      co_return {static_cast<socket::TransferStatus>(error), 0};
+    }
+    switch (output->append(data)) {
+    case detail::OutputQueue::AppendResult::FLUSH_NEEDED:
+      _io_service->request_flush(*output);
+      break;
+    case detail::OutputQueue::AppendResult::FULL:
+      co_return {socket::TransferStatus::OUTPUT_QUEUE_FULL, 0};
+    case detail::OutputQueue::AppendResult::QUEUED:
+      break;
+    }
+    co_return {socket::TransferStatus::OK, data.size()};
+  }
+
+  // tried inline first, like recieve.
+  auto readiness = _state->readiness(detail::PollType::WRITE);
+  auto bytes = ::send(_fd, data.data(), data.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+
+#ifdef LIBCORO_IO_URING
+  if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK) &&
+      _io_service->io_uring_enabled()) {
+    auto result = co_await _io_service->submit(*_state, [&](struct io_uring_sqe* sqe) {
+      detail::IOUring::prep_send(sqe, _fd, data.data(), data.size(), MSG_NOSIGNAL);
+    });
+    if (!_state) {
+      // closed while in flight, the operation was cancelled.
+      co_return {socket::TransferStatus::CLOSED, 0};
+    }
+    if (result >= 0) {
+      co_return {socket::TransferStatus::OK, static_cast<std::size_t>(result)};
+    }
+    co_return {static_cast<socket::TransferStatus>(-result), 0};
+  }
+#endif
+
+  while (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    _state->clear_ready(detail::PollType::WRITE, readiness);
+    co_await _io_service->wait_ready(*_state, detail::PollType::WRITE);
+    if (!_state) {
+      // closed while waiting.
+      errno = EBADF;
+      break;
+    }
+    readiness = _state->readiness(detail::PollType::WRITE);
+    bytes = ::send(_fd, data.data(), data.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+  }
   if (bytes >= 0) {
     co_return {socket::TransferStatus::OK, bytes};
   } else {
@@ -228,7 +769,7 @@ Socket<Executor>::send(std::span<const char> data) {
 template <concepts::executor Executor>
 std::pair<socket::TransferStatus, std::size_t>
 Socket<Executor>::send_sync(std::span<const char> data) {
-  auto bytes = ::send(_fd, data.data(), data.size(), 0);
+  auto bytes = ::send(_fd, data.data(), data.size(), MSG_NOSIGNAL);
   if (bytes >= 0) {
     return {socket::TransferStatus::OK, bytes};
   } else {
@@ -236,11 +777,338 @@ Socket<Executor>::send_sync(std::span<const char> data) {
   }
 }
 
+template <concepts::executor Executor>
+Task<std::pair<socket::TransferStatus, std::size_t>>
+Socket<Executor>::send_all(std::span<const char> data) {
+  std::size_t sent = 0;
+  while (sent < data.size()) {
+    auto [status, bytes] = co_await send(data.subspan(sent));
+    if (status != socket::TransferStatus::OK) {
+      co_return {status, sent};
+    }
+    sent += bytes;
+  }
+  co_return {socket::TransferStatus::OK, sent};
+}
+
+template <concepts::executor Executor>
+Task<std::pair<socket::TransferStatus, std::size_t>>
+Socket<Executor>::send_file(int fd, ::off_t offset, std::size_t length) {
+  if (_fd == -1) {
+    throw std::runtime_error("File descriptor is null");
+  }
+
+  // sendfile has no io_uring opcode, it always goes through readiness.
+  std::size_t sent = 0;
+  auto readiness = _state->readiness(detail::PollType::WRITE);
+  while (sent < length) {
+    ::ssize_t bytes = 0;
+    {
+#ifdef __linux__
+      // SIGPIPE is blocked once per stretch of chunks sent without suspending, not per chunk.
+      detail::SigpipeBlock sigpipe{};
+#endif
+      while (sent < length) {
+#ifdef __linux__
+        bytes = sigpipe.sendfile(_fd, fd, &offset, length - sent);
+#elif __APPLE__
+        ::off_t chunk = static_cast<::off_t>(length - sent);
+        if (::sendfile(fd, _fd, offset, &chunk, nullptr, 0) == -1 && chunk == 0) {
+          bytes = -1;
+        } else {
+          offset += chunk;
+          bytes = static_cast<::ssize_t>(chunk);
+        }
+#endif
+        if (bytes <= 0) {
+          break;
+        }
+        sent += static_cast<std::size_t>(bytes);
+        readiness = _state->readiness(detail::PollType::WRITE);
+      }
+    }
+    if (bytes >= 0) {
+      // everything sent, or end of file.
+      break;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      co_return {static_cast<socket::TransferStatus>(errno), sent};
+    }
+
+    _state->clear_ready(detail::PollType::WRITE, readiness);
+    co_await _io_service->wait_ready(*_state, detail::PollType::WRITE);
+    if (!_state) {
+      // closed while waiting.
+      co_return {static_cast<socket::TransferStatus>(EBADF), sent};
+    }
+    readiness = _state->readiness(detail::PollType::WRITE);
+  }
+
+  co_return {socket::TransferStatus::OK, sent};
+}
+
+template <concepts::executor Executor>
+Task<std::pair<socket::TransferStatus, std::size_t>>
+Socket<Executor>::sendv(std::span<const std::span<const char>> buffers) {
+  if (_fd == -1) {
+    throw std::runtime_error("File descriptor is null");
+  }
+
+  std::array<struct iovec, socket::MAX_IO_VECTORS> vectors;
+  auto count = std::min(buffers.size(), vectors.size());
+  for (std::size_t i = 0; i < count; ++i) {
+    vectors[i].iov_base = const_cast<char*>(buffers[i].data());
+    vectors[i].iov_len = buffers[i].size();
+  }
+  struct msghdr message {};
+  message.msg_iov = vectors.data();
+  message.msg_iovlen = count;
+
+  auto readiness = _state->readiness(detail::PollType::WRITE);
+  auto bytes = ::sendmsg(_fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+#ifdef LIBCORO_IO_URING
+  if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK) &&
+      _io_service->io_uring_enabled()) {
+    auto result = co_await _io_service->submit(*_state, [&](struct io_uring_sqe* sqe) {
+      detail::IOUring::prep_sendmsg(sqe, _fd, &message, MSG_NOSIGNAL);
+    });
+    if (!_state) {
+      // closed while in flight, the operation was cancelled.
+      co_return {socket::TransferStatus::CLOSED, 0};
+    }
+    if (result >= 0) {
+      co_return {socket::TransferStatus::OK, static_cast<std::size_t>(result)};
+    }
+    co_return {static_cast<socket::TransferStatus>(-result), 0};
+  }
+#endif
+
+  while (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    _state->clear_ready(detail::PollType::WRITE, readiness);
+    co_await _io_service->wait_ready(*_state, detail::PollType::WRITE);
+    if (!_state) {
+      // closed while waiting.
+      errno = EBADF;
+      break;
+    }
+    readiness = _state->readiness(detail::PollType::WRITE);
+    bytes = ::sendmsg(_fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+  }
+  if (bytes >= 0) {
+    co_return {socket::TransferStatus::OK, static_cast<std::size_t>(bytes)};
+  }
+  co_return {static_cast<socket::TransferStatus>(errno), 0};
+}
+
+template <concepts::executor Executor>
+Task<std::pair<socket::TransferStatus, std::size_t>>
+Socket<Executor>::recvv(std::span<const std::span<char>> buffers) {
+  if (_fd == -1) {
+    throw std::runtime_error("File descriptor is null");
+  }
+
+  std::array<struct iovec, socket::MAX_IO_VECTORS> vectors;
+  auto count = std::min(buffers.size(), vectors.size());
+  for (std::size_t i = 0; i < count; ++i) {
+    vectors[i].iov_base = buffers[i].data();
+    vectors[i].iov_len = buffers[i].size();
+  }
+  struct msghdr message {};
+  message.msg_iov = vectors.data();
+  message.msg_iovlen = count;
+
+  auto readiness = _state->readiness(detail::PollType::READ);
+  auto bytes = ::recvmsg(_fd, &message, MSG_DONTWAIT);
+
+#ifdef LIBCORO_IO_URING
+  if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK) &&
+      _io_service->io_uring_enabled()) {
+    auto result = co_await _io_service->submit(*_state, [&](struct io_uring_sqe* sqe) {
+      detail::IOUring::prep_recvmsg(sqe, _fd, &message, 0);
+    });
+    if (!_state) {
+      // closed while in flight, the operation was cancelled.
+      co_return {socket::TransferStatus::CLOSED, 0};
+    }
+    if (result > 0) {
+      co_return {socket::TransferStatus::OK, static_cast<std::size_t>(result)};
+    } else if (result == 0) {
+      co_return {socket::TransferStatus::CLOSED, 0};
+    }
+    co_return {static_cast<socket::TransferStatus>(-result), 0};
+  }
+#endif
+
+  while (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    _state->clear_ready(detail::PollType::READ, readiness);
+    co_await _io_service->wait_ready(*_state, detail::PollType::READ);
+    if (!_state) {
+      // closed while waiting.
+      errno = EBADF;
+      break;
+    }
+    readiness = _state->readiness(detail::PollType::READ);
+    bytes = ::recvmsg(_fd, &message, MSG_DONTWAIT);
+  }
+  if (bytes > 0) {
+    co_return {socket::TransferStatus::OK, static_cast<std::size_t>(bytes)};
+  } else if (bytes == 0) {
+    co_return {socket::TransferStatus::CLOSED, 0};
+  }
+  co_return {static_cast<socket::TransferStatus>(errno), 0};
+}
+
+#ifdef __linux__
+template <concepts::executor Executor>
+bool Socket<Executor>::enable_zerocopy() {
+  if (_fd == -1 || !detail::enable_zerocopy(_fd)) {
+    return false;
+  }
+  _state->enable_zerocopy();
+  return true;
+}
+
+template <concepts::executor Executor>
+Task<std::pair<socket::TransferStatus, std::size_t>>
+Socket<Executor>::send_zerocopy(std::span<const char> data) {
+  if (_fd == -1) {
+    throw std::runtime_error("File descriptor is null");
+  }
+  if (!_state->zerocopy() || data.empty()) {
+    co_return co_await send(data);
+  }
+
+  // completions are harvested from the error queue by the io thread, so this always goes
+  // through readiness, io_uring or not.
+  constexpr int flags = MSG_ZEROCOPY | MSG_NOSIGNAL | MSG_DONTWAIT;
+  auto readiness = _state->readiness(detail::PollType::WRITE);
+  auto bytes = ::send(_fd, data.data(), data.size(), flags);
+  while (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    _state->clear_ready(detail::PollType::WRITE, readiness);
+    co_await _io_service->wait_ready(*_state, detail::PollType::WRITE);
+    if (!_state) {
+      // closed while waiting.
+      errno = EBADF;
+      break;
+    }
+    readiness = _state->readiness(detail::PollType::WRITE);
+    bytes = ::send(_fd, data.data(), data.size(), flags);
+  }
+  if (bytes == -1 && errno == ENOBUFS) {
+    // out of pinned page budget (optmem), copy instead.
+    co_return co_await send(data);
+  }
+  if (bytes < 0) {
+    co_return {static_cast<socket::TransferStatus>(errno), 0};
+  }
+
+  co_await _io_service->wait_zerocopy(*_state, _zerocopy_sequence++);
+  co_return {socket::TransferStatus::OK, static_cast<std::size_t>(bytes)};
+}
+
+template <concepts::executor Executor>
+Task<std::pair<socket::TransferStatus, std::size_t>>
+Socket<Executor>::send_many(std::span<const std::span<const char>> datagrams) {
+  if (_fd == -1) {
+    throw std::runtime_error("File descriptor is null");
+  }
+
+  std::array<struct iovec, socket::MAX_DATAGRAM_BATCH> vectors;
+  std::array<struct mmsghdr, socket::MAX_DATAGRAM_BATCH> messages{};
+  auto count = std::min(datagrams.size(), messages.size());
+  for (std::size_t i = 0; i < count; ++i) {
+    vectors[i].iov_base = const_cast<char*>(datagrams[i].data());
+    vectors[i].iov_len = datagrams[i].size();
+    messages[i].msg_hdr.msg_iov = &vectors[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  // no mmsg opcode in io_uring, batches always go through readiness. MSG_DONTWAIT keeps a
+  // partially filled batch from blocking on fds that were not opened non-blocking.
+  auto readiness = _state->readiness(detail::PollType::WRITE);
+  auto sent = ::sendmmsg(_fd, messages.data(), static_cast<unsigned>(count),
+                       MSG_NOSIGNAL | MSG_DONTWAIT);
+  while (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    _state->clear_ready(detail::PollType::WRITE, readiness);
+    co_await _io_service->wait_ready(*_state, detail::PollType::WRITE);
+    if (!_state) {
+      // closed while waiting.
+      errno = EBADF;
+      break;
+    }
+    readiness = _state->readiness(detail::PollType::WRITE);
+    sent = ::sendmmsg(_fd, messages.data(), static_cast<unsigned>(count),
+                       MSG_NOSIGNAL | MSG_DONTWAIT);
+  }
+  if (sent >= 0) {
+    co_return {socket::TransferStatus::OK, static_cast<std::size_t>(sent)};
+  }
+  co_return {static_cast<socket::TransferStatus>(errno), 0};
+}
+
+template <concepts::executor Executor>
+Task<std::pair<socket::TransferStatus, std::size_t>>
+Socket<Executor>::recv_many(std::span<const std::span<char>> buffers,
+                            std::span<std::size_t> sizes) {
+  if (_fd == -1) {
+    throw std::runtime_error("File descriptor is null");
+  }
+
+  std::array<struct iovec, socket::MAX_DATAGRAM_BATCH> vectors;
+  std::array<struct mmsghdr, socket::MAX_DATAGRAM_BATCH> messages{};
+  auto count = std::min({buffers.size(), sizes.size(), messages.size()});
+  for (std::size_t i = 0; i < count; ++i) {
+    vectors[i].iov_base = buffers[i].data();
+    vectors[i].iov_len = buffers[i].size();
+    messages[i].msg_hdr.msg_iov = &vectors[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  auto readiness = _state->readiness(detail::PollType::READ);
+  auto received = ::recvmmsg(_fd, messages.data(), static_cast<unsigned>(count),
+                           MSG_DONTWAIT, nullptr);
+  while (received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    _state->clear_ready(detail::PollType::READ, readiness);
+    co_await _io_service->wait_ready(*_state, detail::PollType::READ);
+    if (!_state) {
+      // closed while waiting.
+      errno = EBADF;
+      break;
+    }
+    readiness = _state->readiness(detail::PollType::READ);
+    received = ::recvmmsg(_fd, messages.data(), static_cast<unsigned>(count),
+                           MSG_DONTWAIT, nullptr);
+  }
+  if (received < 0) {
+    co_return {static_cast<socket::TransferStatus>(errno), 0};
+  }
+  for (int i = 0; i < received; ++i) {
+    sizes[i] = messages[i].msg_len;
+  }
+  co_return {socket::TransferStatus::OK, static_cast<std::size_t>(received)};
+}
+#endif
+
+template <concepts::executor Executor>
+bool Socket<Executor>::alive() noexcept {
+  if (_fd == -1) {
+    return false;
+  }
+  char byte;
+  auto bytes = ::recv(_fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  return bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
 template <concepts::executor Executor>
 void Socket<Executor>::close() {
   if (_fd != -1) {
-    ::close(_fd);
-    _fd = -1;
+    auto fd = std::exchange(_fd, -1);
+    if (auto* output = _state->output()) {
+      output->close();
+    }
+    _io_service->deregister_fd(std::move(_state));
+    ::close(fd);
   }
 }
 
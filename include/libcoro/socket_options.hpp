@@ -0,0 +1,41 @@
+#ifndef SOCKET_OPTIONS_HPP
+#define SOCKET_OPTIONS_HPP
+
+#include <optional>
+
+namespace libcoro {
+namespace socket {
+// Socket options, unset fields are left alone. The ones marked linux fail with ENOPROTOOPT on
+// other platforms.
+struct Options {
+  // disable Nagle, small writes leave immediately.
+  std::optional<bool> no_delay{};
+  // linux, ack right away instead of delaying. the kernel drops back to delayed acks on its own,
+  // so this is worth re-applying after reads on latency sensitive connections.
+  std::optional<bool> quick_ack{};
+  // kernel buffer sizes in bytes, linux doubles the value for bookkeeping.
+  std::optional<int> receive_buffer{};
+  std::optional<int> send_buffer{};
+  // linux, microseconds to busy poll the device queue on blocking reads and poll.
+  std::optional<int> busy_poll{};
+  std::optional<bool> reuse_address{};
+  std::optional<bool> reuse_port{};
+  // listeners, length of the pending TCP Fast Open queue. 0 turns it off.
+  std::optional<int> fast_open{};
+  // linux listeners, seconds a connection may sit in the backlog until its first data arrives
+  // before accept sees it.
+  std::optional<int> defer_accept{};
+  // linux, the cpu whose queue receives this socket's packets. on a listener with reuse_port it
+  // steers new connections to the listener of the same cpu.
+  std::optional<int> incoming_cpu{};
+};
+} // namespace socket
+
+namespace detail {
+// applies every set field of `options` to `fd`. stops at the first failure and returns -1 with
+// errno set, like setsockopt.
+int apply_socket_options(int fd, const socket::Options& options) noexcept;
+} // namespace detail
+} // namespace libcoro
+
+#endif // !SOCKET_OPTIONS_HPP
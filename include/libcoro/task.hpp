@@ -185,8 +185,8 @@ public:
     task_awater_base(coroutine_handle_type handle) noexcept: _coroutine_handle(handle) {}
 
     bool await_ready() const noexcept { return false; }
-    std::coroutine_handle<> await_suspend(coroutine_handle_type handle) noexcept {
-      handle.promise().set_coroutine_handle(handle);
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting_coroutine) noexcept {
+      _coroutine_handle.promise().set_coroutine_handle(awaiting_coroutine);
       return _coroutine_handle;
     }
 
@@ -0,0 +1,128 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace libcoro {
+namespace detail {
+// Intrusive timer entry, owned by whoever waits on it (usually an awaiter in a coroutine frame).
+struct TimerNode {
+  TimerNode* prev{nullptr};
+  TimerNode* next{nullptr};
+  // expiry in wheel ticks.
+  std::uint64_t deadline{0};
+
+  bool linked() const noexcept { return next != nullptr; }
+};
+
+// Hierarchical timing wheel (Varghese & Lauck) with four levels of 256 slots. Insertion and
+// cancellation are O(1) list operations; entries on higher levels cascade down as time passes.
+// Not thread safe, the IOService only touches it from its io thread.
+class TimerWheel {
+public:
+  using clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t LEVELS = 4;
+  static constexpr std::size_t SLOT_BITS = 8;
+  static constexpr std::size_t SLOTS = 1 << SLOT_BITS;
+
+  explicit TimerWheel(clock::time_point origin = clock::now(),
+                      clock::duration resolution = std::chrono::milliseconds(1));
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+  TimerWheel(TimerWheel&&) = delete;
+  TimerWheel& operator=(TimerWheel&&) = delete;
+
+  // never fires before `deadline`, at most one tick after it.
+  void add(TimerNode& node, clock::time_point deadline) noexcept;
+  void cancel(TimerNode& node) noexcept;
+
+  // expires every entry due by `now`, `on_expire(node)` may add or cancel entries.
+  template <typename F>
+  std::size_t advance(clock::time_point now, F&& on_expire);
+
+  // the earliest point the wheel has to be advanced again, nullopt when no timer is pending.
+  // exact for timers due within the next rotation, a lower bound for the ones further out.
+  std::optional<clock::time_point> next_expiry() const noexcept;
+
+  std::size_t size() const noexcept { return _size; }
+  bool empty() const noexcept { return _size == 0; }
+
+private:
+  using Slot = TimerNode;
+
+  std::uint64_t ceil_tick(clock::time_point time_point) const noexcept;
+  std::uint64_t floor_tick(clock::time_point time_point) const noexcept;
+  clock::time_point to_time_point(std::uint64_t tick) const noexcept;
+
+  // the first tick after the current one that expires or cascades entries, with entries pending.
+  std::uint64_t next_tick() const noexcept;
+  void insert(TimerNode& node, std::uint64_t earliest) noexcept;
+  void cascade(std::size_t level) noexcept;
+
+  static std::size_t slot_index(std::uint64_t tick, std::size_t level) noexcept {
+    return (tick >> (level * SLOT_BITS)) & (SLOTS - 1);
+  }
+  static bool slot_empty(const Slot& slot) noexcept { return slot.next == &slot; }
+  static void link(Slot& slot, TimerNode& node) noexcept;
+  static void unlink(TimerNode& node) noexcept;
+
+  clock::time_point _origin;
+  clock::duration _resolution;
+  // last tick that has been processed.
+  std::uint64_t _now{0};
+  std::size_t _size{0};
+  std::array<std::array<Slot, SLOTS>, LEVELS> _slots{};
+};
+
+template <typename F>
+std::size_t TimerWheel::advance(clock::time_point now, F&& on_expire) {
+  auto target = floor_tick(now);
+  std::size_t expired = 0;
+
+  while (_now < target) {
+    if (_size == 0) {
+      _now = target;
+      break;
+    }
+    // ticks in between neither expire nor cascade anything, skip right to the next that does.
+    auto next = next_tick();
+    if (next > target) {
+      _now = target;
+      break;
+    }
+
+    _now = next;
+    if (slot_index(_now, 0) == 0) {
+      // entering a new window on level 1 (and maybe above), pull its entries down. higher
+      // levels first, their entries may land in the level 1 slot being cascaded.
+      std::size_t level = 1;
+      while (level + 1 < LEVELS && slot_index(_now, level) == 0) {
+        ++level;
+      }
+      for (; level > 0; --level) {
+        cascade(level);
+      }
+    }
+
+    auto& slot = _slots[0][slot_index(_now, 0)];
+    while (!slot_empty(slot)) {
+      auto& node = *slot.next;
+      unlink(node);
+      --_size;
+      ++expired;
+      on_expire(node);
+    }
+  }
+
+  return expired;
+}
+} // namespace detail
+} // namespace libcoro
+
+#endif // !TIMER_WHEEL_HPP
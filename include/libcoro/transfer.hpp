@@ -0,0 +1,25 @@
+#ifndef TRANSFER_HPP
+#define TRANSFER_HPP
+
+#include "libcoro/file.hpp"
+#include "libcoro/socket.hpp"
+#include "libcoro/task.hpp"
+#include <cstddef>
+#include <stdexcept>
+#include <sys/types.h>
+#include <utility>
+
+namespace libcoro {
+// serves `length` bytes of `file` from `offset` on `socket` without copying them through user
+// space. the file position is left untouched.
+template <concepts::executor Executor>
+Task<std::pair<socket::TransferStatus, std::size_t>>
+transfer(File<Executor>& file, Socket<Executor>& socket, ::off_t offset, std::size_t length) {
+  if (file.fd() == -1) {
+    throw std::runtime_error("File descriptor is null");
+  }
+  return socket.send_file(file.fd(), offset, length);
+}
+} // namespace libcoro
+
+#endif // !TRANSFER_HPP
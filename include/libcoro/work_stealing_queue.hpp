@@ -0,0 +1,141 @@
+#ifndef WORK_STEALING_QUEUE_HPP
+#define WORK_STEALING_QUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace libcoro {
+namespace detail {
+// Chase-Lev work stealing deque, following "Correct and Efficient Work-Stealing for Weak Memory
+// Models" (Le et al., PPoPP'13). The owner thread pushes and pops at the bottom, any other thread
+// may steal from the top. T must be a pointer-sized trivially copyable type.
+template <typename T>
+class WorkStealingQueue {
+  class Buffer {
+  public:
+    explicit Buffer(std::int64_t capacity)
+        : _capacity(capacity), _mask(capacity - 1),
+          _items(std::make_unique<std::atomic<T>[]>(capacity)) {}
+
+    std::int64_t capacity() const noexcept { return _capacity; }
+
+    void put(std::int64_t idx, T item) noexcept {
+      _items[idx & _mask].store(item, std::memory_order_relaxed);
+    }
+    T get(std::int64_t idx) const noexcept {
+      return _items[idx & _mask].load(std::memory_order_relaxed);
+    }
+
+    Buffer* grow(std::int64_t bottom, std::int64_t top) const {
+      auto* buffer = new Buffer(_capacity * 2);
+      for (auto i = top; i != bottom; ++i) {
+        buffer->put(i, get(i));
+      }
+      return buffer;
+    }
+
+  private:
+    std::int64_t _capacity;
+    std::int64_t _mask;
+    std::unique_ptr<std::atomic<T>[]> _items;
+  };
+
+public:
+  explicit WorkStealingQueue(std::int64_t capacity = 256): _buffer(new Buffer(capacity)) {
+    _retired.emplace_back(_buffer.load(std::memory_order_relaxed));
+  }
+
+  WorkStealingQueue(const WorkStealingQueue&) = delete;
+  WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+  WorkStealingQueue(WorkStealingQueue&&) = delete;
+  WorkStealingQueue& operator=(WorkStealingQueue&&) = delete;
+
+  bool empty() const noexcept {
+    auto bottom = _bottom.load(std::memory_order_relaxed);
+    auto top = _top.load(std::memory_order_relaxed);
+    return bottom <= top;
+  }
+
+  std::size_t size() const noexcept {
+    auto bottom = _bottom.load(std::memory_order_relaxed);
+    auto top = _top.load(std::memory_order_relaxed);
+    return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
+  }
+
+  // owner only
+  void push(T item) {
+    auto bottom = _bottom.load(std::memory_order_relaxed);
+    auto top = _top.load(std::memory_order_acquire);
+    auto* buffer = _buffer.load(std::memory_order_relaxed);
+
+    if (bottom - top > buffer->capacity() - 1) {
+      // stealers may still read from the old buffer, keep it alive until the queue dies.
+      buffer = buffer->grow(bottom, top);
+      _retired.emplace_back(buffer);
+      _buffer.store(buffer, std::memory_order_release);
+    }
+
+    buffer->put(bottom, item);
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  // owner only
+  std::optional<T> pop() noexcept {
+    auto bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    auto* buffer = _buffer.load(std::memory_order_relaxed);
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = _top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+
+    T item = buffer->get(bottom);
+    if (top == bottom) {
+      // last item, race against stealers.
+      if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+        return std::nullopt;
+      }
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // any thread
+  std::optional<T> steal() noexcept {
+    auto top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto bottom = _bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom) {
+      return std::nullopt;
+    }
+
+    auto* buffer = _buffer.load(std::memory_order_acquire);
+    T item = buffer->get(top);
+    if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return std::nullopt;
+    }
+    return item;
+  }
+
+private:
+  alignas(64) std::atomic<std::int64_t> _top{0};
+  alignas(64) std::atomic<std::int64_t> _bottom{0};
+  alignas(64) std::atomic<Buffer*> _buffer;
+
+  std::vector<std::unique_ptr<Buffer>> _retired{};
+};
+} // namespace detail
+} // namespace libcoro
+
+#endif // !WORK_STEALING_QUEUE_HPP
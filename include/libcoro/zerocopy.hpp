@@ -0,0 +1,28 @@
+#ifndef ZEROCOPY_HPP
+#define ZEROCOPY_HPP
+
+#ifdef __linux__
+
+#include <cstdint>
+
+namespace libcoro {
+namespace detail {
+// what a pass over a socket's error queue turned up.
+struct ZerocopyHarvest {
+  // every send with a sequence number below this has been released, valid when `completed`.
+  std::uint32_t released{0};
+  bool completed{false};
+  // something other than a zerocopy notification was queued, a real socket error.
+  bool error{false};
+};
+
+// sets SO_ZEROCOPY, false when the kernel or the socket type does not support it.
+bool enable_zerocopy(int fd) noexcept;
+// drains the error queue without blocking.
+ZerocopyHarvest harvest_zerocopy(int fd) noexcept;
+} // namespace detail
+} // namespace libcoro
+
+#endif // __linux__
+
+#endif // !ZEROCOPY_HPP
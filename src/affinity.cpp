@@ -0,0 +1,27 @@
+#include "libcoro/affinity.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace libcoro {
+namespace detail {
+std::size_t cpu_count() noexcept {
+  auto count = std::thread::hardware_concurrency();
+  return count == 0 ? 1 : count;
+}
+
+#ifdef __linux__
+bool pin_thread(std::thread& thread, std::size_t cpu) noexcept {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu % cpu_count(), &cpu_set);
+  return ::pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set) == 0;
+}
+#else
+// macOS only offers affinity tags as scheduling hints, there is no hard pinning.
+bool pin_thread(std::thread&, std::size_t) noexcept { return false; }
+#endif
+} // namespace detail
+} // namespace libcoro
@@ -0,0 +1,41 @@
+#include "libcoro/append_log.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+
+namespace libcoro {
+namespace detail {
+int write_durably(int fd, std::span<struct ::iovec> iovecs, ::off_t offset) noexcept {
+  while (!iovecs.empty()) {
+    auto count = std::min<std::size_t>(iovecs.size(), IOV_MAX);
+    auto written = ::pwritev(fd, iovecs.data(), static_cast<int>(count), offset);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    offset += written;
+
+    // drop what was written, a short write leaves the first remaining iovec partly done.
+    auto left = static_cast<std::size_t>(written);
+    while (!iovecs.empty() && left >= iovecs.front().iov_len) {
+      left -= iovecs.front().iov_len;
+      iovecs = iovecs.subspan(1);
+    }
+    if (left != 0) {
+      iovecs.front().iov_base = static_cast<char*>(iovecs.front().iov_base) + left;
+      iovecs.front().iov_len -= left;
+    }
+  }
+
+#ifdef __APPLE__
+  // no fdatasync on macOS.
+  return ::fsync(fd);
+#else
+  return ::fdatasync(fd);
+#endif
+}
+} // namespace detail
+} // namespace libcoro
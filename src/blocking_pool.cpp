@@ -0,0 +1,117 @@
+#include "libcoro/blocking_pool.hpp"
+
+#include <utility>
+
+namespace libcoro {
+namespace detail {
+void BlockingPool::submit(BlockingJob& job) {
+  join_exited();
+
+  job.next = nullptr;
+  {
+    std::unique_lock lock(_mutex);
+    if (_stopping) {
+      // nobody is left to run it.
+      lock.unlock();
+      job.run(&job);
+      return;
+    }
+    if (_tail != nullptr) {
+      _tail->next = &job;
+    } else {
+      _head = &job;
+    }
+    _tail = &job;
+    ++_queued;
+
+    // every queued job claims one idle thread, the ones a woken thread has not taken yet
+    // included. a job left without one gets a new thread.
+    if (_queued > _idle && _threads.size() < _max_threads) {
+      // the thread needs the lock before it looks at its own entry, it is set by then.
+      auto self = _threads.emplace(_threads.end());
+      *self = std::thread(&BlockingPool::worker_function, this, self);
+      return;
+    }
+  }
+  _cv.notify_one();
+}
+
+void BlockingPool::shutdown() {
+  thread_list threads;
+  {
+    std::scoped_lock lock(_mutex);
+    _stopping = true;
+    threads.swap(_threads);
+  }
+  _cv.notify_all();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  join_exited();
+}
+
+void BlockingPool::set_max_threads(std::size_t max_threads) {
+  {
+    std::scoped_lock lock(_mutex);
+    _max_threads = max_threads;
+  }
+  _cv.notify_all();
+}
+
+std::size_t BlockingPool::threads() const {
+  std::scoped_lock lock(_mutex);
+  return _threads.size();
+}
+
+void BlockingPool::join_exited() {
+  std::vector<std::thread> exited;
+  {
+    std::scoped_lock lock(_mutex);
+    if (_exited.empty()) {
+      return;
+    }
+    exited.swap(_exited);
+  }
+  for (auto& thread : exited) {
+    thread.join();
+  }
+}
+
+void BlockingPool::worker_function(thread_list::iterator self) {
+  std::unique_lock lock(_mutex);
+  while (true) {
+    ++_idle;
+    auto woken = _cv.wait_for(lock, _idle_timeout, [this]() {
+      return _head != nullptr || _stopping || _threads.size() > _max_threads;
+    });
+    --_idle;
+
+    if (_head == nullptr) {
+      if (_stopping) {
+        // shutdown owns the thread list now and joins us.
+        return;
+      }
+      if (!woken || _threads.size() > _max_threads) {
+        // idle for too long or over the limit, hand ourselves over to be joined.
+        _exited.push_back(std::move(*self));
+        _threads.erase(self);
+        return;
+      }
+      continue;
+    }
+
+    auto* job = _head;
+    --_queued;
+    _head = job->next;
+    if (_head == nullptr) {
+      _tail = nullptr;
+    }
+
+    lock.unlock();
+    // the job may be gone once it ran, it belongs to a coroutine that is resumed by it.
+    job->run(job);
+    lock.lock();
+  }
+}
+} // namespace detail
+} // namespace libcoro
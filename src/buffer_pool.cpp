@@ -0,0 +1,102 @@
+#include "libcoro/buffer_pool.hpp"
+#include <new>
+#include <utility>
+
+namespace libcoro {
+namespace {
+// buffers start on their own cache line.
+constexpr std::align_val_t BUFFER_ALIGNMENT{64};
+} // namespace
+
+BufferLease::BufferLease(BufferLease&& other) noexcept
+    : _pool(std::exchange(other._pool, nullptr)),
+      _data(std::exchange(other._data, nullptr)),
+      _size(std::exchange(other._size, 0)),
+      _capacity(std::exchange(other._capacity, 0)),
+      _size_class(std::exchange(other._size_class, 0)) {}
+
+BufferLease& BufferLease::operator=(BufferLease&& other) noexcept {
+  if (std::addressof(other) != this) {
+    release();
+    _pool = std::exchange(other._pool, nullptr);
+    _data = std::exchange(other._data, nullptr);
+    _size = std::exchange(other._size, 0);
+    _capacity = std::exchange(other._capacity, 0);
+    _size_class = std::exchange(other._size_class, 0);
+  }
+  return *this;
+}
+
+void BufferLease::release() noexcept {
+  if (_data != nullptr) {
+    _pool->release(_data, _size_class);
+    _data = nullptr;
+    _size = 0;
+    _capacity = 0;
+  }
+}
+
+namespace detail {
+BufferPool::BufferPool() {
+  for (auto& size_class : _classes) {
+    // returning a buffer never allocates.
+    size_class.free.reserve(MAX_CACHED);
+  }
+}
+
+BufferPool::~BufferPool() {
+  for (auto& size_class : _classes) {
+    for (auto* data : size_class.free) {
+      deallocate(data);
+    }
+  }
+}
+
+BufferLease BufferPool::acquire(std::size_t size) {
+  auto idx = size_class(size);
+  if (idx == SIZE_CLASSES) {
+    return BufferLease{this, allocate(size), size, size, idx};
+  }
+
+  auto& size_class = _classes[idx];
+  {
+    std::scoped_lock lock(size_class.mutex);
+    if (!size_class.free.empty()) {
+      auto* data = size_class.free.back();
+      size_class.free.pop_back();
+      return BufferLease{this, data, size, class_size(idx), idx};
+    }
+  }
+  return BufferLease{this, allocate(class_size(idx)), size, class_size(idx), idx};
+}
+
+std::size_t BufferPool::size_class(std::size_t size) noexcept {
+  if (size > MAX_BUFFER_SIZE) {
+    return SIZE_CLASSES;
+  }
+  std::size_t idx = 0;
+  while (class_size(idx) < size) {
+    ++idx;
+  }
+  return idx;
+}
+
+char* BufferPool::allocate(std::size_t size) {
+  return static_cast<char*>(::operator new(size, BUFFER_ALIGNMENT));
+}
+
+void BufferPool::deallocate(char* data) noexcept { ::operator delete(data, BUFFER_ALIGNMENT); }
+
+void BufferPool::release(char* data, std::size_t idx) noexcept {
+  if (idx < SIZE_CLASSES) {
+    auto& size_class = _classes[idx];
+    std::scoped_lock lock(size_class.mutex);
+    if (size_class.free.size() < MAX_CACHED) {
+      size_class.free.push_back(data);
+      return;
+    }
+  }
+  deallocate(data);
+}
+} // namespace detail
+} // namespace libcoro
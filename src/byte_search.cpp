@@ -0,0 +1,93 @@
+#include "libcoro/byte_search.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LIBCORO_X86_SIMD
+#endif
+
+namespace libcoro {
+namespace detail {
+namespace {
+constexpr auto npos = std::string_view::npos;
+
+#ifdef LIBCORO_X86_SIMD
+std::size_t find_byte_sse2(const char* data, std::size_t size, char byte) noexcept {
+  auto needle = _mm_set1_epi8(byte);
+  std::size_t offset = 0;
+  for (; offset + 16 <= size; offset += 16) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+    auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+    if (mask != 0) {
+      return offset + static_cast<std::size_t>(__builtin_ctz(mask));
+    }
+  }
+  for (; offset < size; ++offset) {
+    if (data[offset] == byte) {
+      return offset;
+    }
+  }
+  return npos;
+}
+
+__attribute__((target("avx2"))) std::size_t find_byte_avx2(const char* data, std::size_t size,
+                                                           char byte) noexcept {
+  auto needle = _mm256_set1_epi8(byte);
+  std::size_t offset = 0;
+  for (; offset + 32 <= size; offset += 32) {
+    auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset));
+    auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+    if (mask != 0) {
+      return offset + static_cast<std::size_t>(__builtin_ctz(mask));
+    }
+  }
+  auto found = find_byte_sse2(data + offset, size - offset, byte);
+  return found == npos ? npos : offset + found;
+}
+
+using FindByte = std::size_t (*)(const char*, std::size_t, char) noexcept;
+
+FindByte select_find_byte() noexcept {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? find_byte_avx2 : find_byte_sse2;
+}
+
+// resolved once, the same way on every call after.
+const FindByte find_byte_impl = select_find_byte();
+#endif
+} // namespace
+
+std::size_t find_byte(std::string_view data, char byte) noexcept {
+#ifdef LIBCORO_X86_SIMD
+  return find_byte_impl(data.data(), data.size(), byte);
+#else
+  auto found = std::memchr(data.data(), byte, data.size());
+  return found == nullptr ? npos : static_cast<std::size_t>(static_cast<const char*>(found) -
+                                                            data.data());
+#endif
+}
+
+std::size_t find_delimiter(std::string_view data, std::string_view delimiter) noexcept {
+  if (delimiter.empty()) {
+    return 0;
+  }
+
+  // vector scan for the first byte, then confirm the rest of the delimiter.
+  std::size_t offset = 0;
+  while (offset + delimiter.size() <= data.size()) {
+    auto found = find_byte(data.substr(offset, data.size() - offset - delimiter.size() + 1),
+                           delimiter.front());
+    if (found == npos) {
+      return npos;
+    }
+    offset += found;
+    if (std::memcmp(data.data() + offset + 1, delimiter.data() + 1, delimiter.size() - 1) == 0) {
+      return offset;
+    }
+    ++offset;
+  }
+  return npos;
+}
+} // namespace detail
+} // namespace libcoro
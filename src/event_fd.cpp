@@ -2,6 +2,10 @@
 #include <stdexcept>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
 namespace libcoro {
 namespace detail {
 #ifdef __APPLE__
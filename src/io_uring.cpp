@@ -0,0 +1,201 @@
+#include "libcoro/io_uring.hpp"
+
+#ifdef LIBCORO_IO_URING
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace libcoro {
+namespace detail {
+namespace {
+int io_uring_setup(unsigned entries, struct io_uring_params* params) noexcept {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) noexcept {
+  return static_cast<int>(
+      ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+template <typename T>
+T* at_offset(void* base, unsigned offset) noexcept {
+  return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+} // namespace
+
+IOUring::IOUring(unsigned entries) {
+  struct io_uring_params params {};
+  _ring_fd = io_uring_setup(entries, &params);
+  if (_ring_fd < 0) {
+    throw std::runtime_error("Failed to set up io_uring");
+  }
+  _entries = params.sq_entries;
+
+  _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  _sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  _sq_ring = ::mmap(nullptr, _sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    _ring_fd, IORING_OFF_SQ_RING);
+  _cq_ring = ::mmap(nullptr, _cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    _ring_fd, IORING_OFF_CQ_RING);
+  auto* sqes = ::mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      _ring_fd, IORING_OFF_SQES);
+  if (_sq_ring == MAP_FAILED || _cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+    _sqes = sqes == MAP_FAILED ? nullptr : static_cast<struct io_uring_sqe*>(sqes);
+    _sq_ring = _sq_ring == MAP_FAILED ? nullptr : _sq_ring;
+    _cq_ring = _cq_ring == MAP_FAILED ? nullptr : _cq_ring;
+    release();
+    throw std::runtime_error("Failed to map io_uring");
+  }
+  _sqes = static_cast<struct io_uring_sqe*>(sqes);
+
+  _sq_head = at_offset<unsigned>(_sq_ring, params.sq_off.head);
+  _sq_tail = at_offset<unsigned>(_sq_ring, params.sq_off.tail);
+  _sq_mask = at_offset<unsigned>(_sq_ring, params.sq_off.ring_mask);
+  _sq_array = at_offset<unsigned>(_sq_ring, params.sq_off.array);
+  _sqe_tail = *_sq_tail;
+
+  _cq_head = at_offset<unsigned>(_cq_ring, params.cq_off.head);
+  _cq_tail = at_offset<unsigned>(_cq_ring, params.cq_off.tail);
+  _cq_mask = at_offset<unsigned>(_cq_ring, params.cq_off.ring_mask);
+  _cqes = at_offset<struct io_uring_cqe>(_cq_ring, params.cq_off.cqes);
+}
+
+IOUring::~IOUring() { release(); }
+
+void IOUring::release() noexcept {
+  if (_sqes != nullptr) {
+    ::munmap(_sqes, _sqes_size);
+    _sqes = nullptr;
+  }
+  if (_cq_ring != nullptr) {
+    ::munmap(_cq_ring, _cq_ring_size);
+    _cq_ring = nullptr;
+  }
+  if (_sq_ring != nullptr) {
+    ::munmap(_sq_ring, _sq_ring_size);
+    _sq_ring = nullptr;
+  }
+  if (_ring_fd != -1) {
+    ::close(_ring_fd);
+    _ring_fd = -1;
+  }
+}
+
+bool IOUring::supported() noexcept {
+  struct io_uring_params params {};
+  auto fd = io_uring_setup(1, &params);
+  if (fd < 0) {
+    return false;
+  }
+  ::close(fd);
+  return true;
+}
+
+unsigned IOUring::available() const noexcept {
+  std::atomic_ref<unsigned> sq_head(*_sq_head);
+  return _entries - (_sqe_tail - sq_head.load(std::memory_order_acquire));
+}
+
+struct io_uring_sqe* IOUring::get_sqe() noexcept {
+  if (available() == 0) {
+    return nullptr;
+  }
+
+  auto idx = _sqe_tail & *_sq_mask;
+  _sq_array[idx] = idx;
+  ++_sqe_tail;
+  ++_to_submit;
+
+  auto* sqe = &_sqes[idx];
+  std::memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+int IOUring::submit() noexcept {
+  if (_to_submit == 0) {
+    return 0;
+  }
+
+  std::atomic_ref<unsigned> sq_tail(*_sq_tail);
+  sq_tail.store(_sqe_tail, std::memory_order_release);
+
+  int submitted;
+  do {
+    submitted = io_uring_enter(_ring_fd, _to_submit, 0, 0);
+  } while (submitted == -1 && errno == EINTR);
+
+  if (submitted < 0) {
+    return -errno;
+  }
+  _to_submit -= static_cast<unsigned>(submitted);
+  return submitted;
+}
+
+void IOUring::prep_rw(int op, struct io_uring_sqe* sqe, int fd, const void* addr, unsigned len,
+                      std::uint64_t offset) noexcept {
+  sqe->opcode = static_cast<__u8>(op);
+  sqe->fd = fd;
+  sqe->off = offset;
+  sqe->addr = reinterpret_cast<std::uint64_t>(addr);
+  sqe->len = len;
+}
+
+void IOUring::prep_recv(struct io_uring_sqe* sqe, int fd, void* buffer, std::size_t size,
+                        int flags) noexcept {
+  prep_rw(IORING_OP_RECV, sqe, fd, buffer, static_cast<unsigned>(size), 0);
+  sqe->msg_flags = static_cast<__u32>(flags);
+}
+
+void IOUring::prep_send(struct io_uring_sqe* sqe, int fd, const void* buffer, std::size_t size,
+                        int flags) noexcept {
+  prep_rw(IORING_OP_SEND, sqe, fd, buffer, static_cast<unsigned>(size), 0);
+  sqe->msg_flags = static_cast<__u32>(flags);
+}
+
+void IOUring::prep_recvmsg(struct io_uring_sqe* sqe, int fd, struct msghdr* msg,
+                           int flags) noexcept {
+  prep_rw(IORING_OP_RECVMSG, sqe, fd, msg, 1, 0);
+  sqe->msg_flags = static_cast<__u32>(flags);
+}
+
+void IOUring::prep_sendmsg(struct io_uring_sqe* sqe, int fd, const struct msghdr* msg,
+                           int flags) noexcept {
+  prep_rw(IORING_OP_SENDMSG, sqe, fd, msg, 1, 0);
+  sqe->msg_flags = static_cast<__u32>(flags);
+}
+
+void IOUring::prep_read(struct io_uring_sqe* sqe, int fd, void* buffer, std::size_t size,
+                        ::off_t offset) noexcept {
+  prep_rw(IORING_OP_READ, sqe, fd, buffer, static_cast<unsigned>(size),
+          static_cast<std::uint64_t>(offset));
+}
+
+void IOUring::prep_write(struct io_uring_sqe* sqe, int fd, const void* buffer, std::size_t size,
+                         ::off_t offset) noexcept {
+  prep_rw(IORING_OP_WRITE, sqe, fd, buffer, static_cast<unsigned>(size),
+          static_cast<std::uint64_t>(offset));
+}
+
+void IOUring::prep_connect(struct io_uring_sqe* sqe, int fd, const struct sockaddr* addr,
+                           socklen_t addr_len) noexcept {
+  prep_rw(IORING_OP_CONNECT, sqe, fd, addr, 0, addr_len);
+}
+
+void IOUring::prep_cancel(struct io_uring_sqe* sqe, std::uint64_t user_data) noexcept {
+  prep_rw(IORING_OP_ASYNC_CANCEL, sqe, -1, reinterpret_cast<const void*>(user_data), 0, 0);
+}
+
+void IOUring::prep_link_timeout(struct io_uring_sqe* sqe,
+                                struct __kernel_timespec* timeout) noexcept {
+  prep_rw(IORING_OP_LINK_TIMEOUT, sqe, -1, timeout, 1, 0);
+}
+} // namespace detail
+} // namespace libcoro
+
+#endif // LIBCORO_IO_URING
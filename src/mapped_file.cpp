@@ -0,0 +1,49 @@
+#include "libcoro/mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace libcoro {
+namespace detail {
+const char* map_readonly(int fd, std::size_t size) noexcept {
+  auto* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+#ifdef MADV_HUGEPAGE
+  if (size >= file::HUGEPAGE_THRESHOLD) {
+    // only honoured where the kernel supports huge pages for file mappings, ignore the result.
+    ::madvise(data, size, MADV_HUGEPAGE);
+  }
+#endif
+  return static_cast<const char*>(data);
+}
+
+void unmap(const char* data, std::size_t size) noexcept {
+  ::munmap(const_cast<char*>(data), size);
+}
+
+int prefetch_mapping(int fd, const char* data, std::size_t offset, std::size_t length) noexcept {
+  // madvise wants a page aligned start.
+  auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  auto begin = offset / page * page;
+  auto* address = const_cast<char*>(data) + begin;
+  length += offset - begin;
+
+#ifdef MADV_POPULATE_READ
+  // reads the pages and maps them too, so the first lookup doesn't even take a minor fault.
+  if (::madvise(address, length, MADV_POPULATE_READ) == 0) {
+    return 0;
+  }
+#endif
+#ifdef __linux__
+  // unlike MADV_WILLNEED, readahead waits for the reads it starts.
+  ::readahead(fd, static_cast<::off_t>(begin), length);
+#else
+  (void)fd;
+#endif
+  return ::madvise(address, length, MADV_WILLNEED);
+}
+} // namespace detail
+} // namespace libcoro
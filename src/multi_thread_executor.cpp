@@ -1,10 +1,50 @@
 #include "libcoro/multi_thread_executor.hpp"
+#include "libcoro/output_queue.hpp"
 #include <atomic>
+#include <stdexcept>
+#include <utility>
 
 namespace libcoro {
-MultiThreadExecutor::MultiThreadExecutor(std::size_t size): _size(size) {
-  _threads.reserve(_size);
-  for (std::size_t i = 0; i < _size; ++i) {
+namespace {
+// at most this many handles are moved from the injection queue to a local queue at once.
+constexpr std::size_t GLOBAL_BATCH_SIZE = 32;
+constexpr int SPIN_ROUNDS = 64;
+// consecutive runs taken from the `next` slot before the worker looks at its queues again, so
+// two coroutines waking each other cannot starve everything else.
+constexpr std::uint32_t MAX_NEXT_RUNS = 3;
+// the injection queue is checked first every this many runs, so a busy local queue cannot starve
+// external submissions.
+constexpr std::uint32_t GLOBAL_POLL_INTERVAL = 61;
+
+struct CurrentWorker {
+  MultiThreadExecutor* executor{nullptr};
+  std::size_t idx{0};
+};
+
+thread_local CurrentWorker current_worker{};
+
+std::uint64_t xorshift(std::uint64_t& state) noexcept {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+} // namespace
+
+MultiThreadExecutor::MultiThreadExecutor(std::size_t size) {
+  if (size == 0) {
+    throw std::invalid_argument("MultiThreadExecutor requires at least one thread");
+  }
+
+  _workers.reserve(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    auto worker = std::make_unique<Worker>();
+    worker->steal_seed = 0x9E3779B97F4A7C15ull * (i + 1);
+    _workers.emplace_back(std::move(worker));
+  }
+
+  _threads.reserve(size);
+  for (std::size_t i = 0; i < size; ++i) {
     _threads.emplace_back([this, i] { thread_function(i); });
   }
 }
@@ -13,7 +53,6 @@ MultiThreadExecutor::~MultiThreadExecutor() { shutdown(); }
 
 MultiThreadExecutor::Awaiter MultiThreadExecutor::start() {
   if (!_shutdown_requested.load(std::memory_order_acquire)) {
-    _size.fetch_add(1, std::memory_order_release);
     return Awaiter{*this};
   }
 
@@ -24,10 +63,36 @@ void MultiThreadExecutor::resume(std::coroutine_handle<> handle) {
   if (!handle) {
     return;
   }
-  _size.fetch_add(1, std::memory_order_release);
   execute(handle);
 }
 
+void MultiThreadExecutor::resume_batch(std::span<std::coroutine_handle<>> handles) {
+  std::size_t count = 0;
+  if (current_worker.executor == this) {
+    // no `next` slot here, a batch is not a single continuation.
+    auto& worker = *_workers[current_worker.idx];
+    for (auto handle : handles) {
+      if (handle) {
+        worker.queue.push(handle);
+        ++count;
+      }
+    }
+  } else {
+    std::scoped_lock lock(_global_mutex);
+    for (auto handle : handles) {
+      if (handle) {
+        _global_handles.push_back(handle);
+        ++count;
+      }
+    }
+  }
+
+  if (count > 0) {
+    _size.fetch_add(static_cast<std::int64_t>(count), std::memory_order_seq_cst);
+    wake_idle_workers(count);
+  }
+}
+
 void MultiThreadExecutor::shutdown() {
   if (_shutdown_requested.exchange(true, std::memory_order_acq_rel) == false) {
     {
@@ -47,31 +112,146 @@ void MultiThreadExecutor::execute(std::coroutine_handle<> handle) {
   if (!handle) {
     return;
   }
-  {
+
+  if (current_worker.executor == this) {
+    // the current coroutine is about to suspend, run the woken one next on this worker. the
+    // displaced handle, if any, becomes stealable.
+    auto& worker = *_workers[current_worker.idx];
+    handle = std::exchange(worker.next, handle);
+    if (!handle) {
+      return;
+    }
+    worker.queue.push(handle);
+  } else {
+    std::scoped_lock lock(_global_mutex);
+    _global_handles.push_back(handle);
+  }
+
+  _size.fetch_add(1, std::memory_order_seq_cst);
+  wake_idle_workers();
+}
+
+void MultiThreadExecutor::wake_idle_workers(std::size_t count) {
+  // pairs with the seq_cst increment of _idle_workers in thread_function: either the parking
+  // worker observes the new item, or we observe the parking worker and notify it.
+  auto idle = _idle_workers.load(std::memory_order_seq_cst);
+  if (idle > 0) {
     std::scoped_lock lock(_wait_mutex);
-    _handles.push_back(handle);
+    if (count >= idle) {
+      _wait_cv.notify_all();
+    } else {
+      for (std::size_t i = 0; i < count; ++i) {
+        _wait_cv.notify_one();
+      }
+    }
+  }
+}
+
+std::optional<std::coroutine_handle<>> MultiThreadExecutor::pop_global(std::size_t idx) {
+  std::scoped_lock lock(_global_mutex);
+  if (_global_handles.empty()) {
+    return std::nullopt;
+  }
+
+  auto handle = _global_handles.front();
+  _global_handles.pop_front();
+
+  // move a share of the remaining handles to the local queue so other workers can steal them
+  // without going through the global lock.
+  auto& queue = _workers[idx]->queue;
+  auto batch = std::min(GLOBAL_BATCH_SIZE, _global_handles.size() / _workers.size());
+  for (std::size_t i = 0; i < batch; ++i) {
+    queue.push(_global_handles.front());
+    _global_handles.pop_front();
+  }
+  return handle;
+}
+
+std::optional<std::coroutine_handle<>> MultiThreadExecutor::steal(std::size_t idx) {
+  auto count = _workers.size();
+  if (count == 1) {
+    return std::nullopt;
+  }
+
+  auto start = xorshift(_workers[idx]->steal_seed) % count;
+  for (std::size_t i = 0; i < count; ++i) {
+    auto victim = (start + i) % count;
+    if (victim == idx) {
+      continue;
+    }
+    if (auto handle = _workers[victim]->queue.steal()) {
+      return handle;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<std::coroutine_handle<>> MultiThreadExecutor::next_handle(std::size_t idx) {
+  auto& worker = *_workers[idx];
+  if (++worker.tick % GLOBAL_POLL_INTERVAL == 0) {
+    if (auto handle = pop_global(idx)) {
+      _size.fetch_sub(1, std::memory_order_release);
+      return handle;
+    }
+  }
+
+  if (worker.next && worker.next_runs < MAX_NEXT_RUNS) {
+    ++worker.next_runs;
+    return std::exchange(worker.next, nullptr);
+  }
+  worker.next_runs = 0;
+
+  auto handle = worker.queue.pop();
+  if (!handle) {
+    handle = pop_global(idx);
+  }
+  if (!handle) {
+    handle = steal(idx);
   }
-  _wait_cv.notify_one();
+  if (handle) {
+    _size.fetch_sub(1, std::memory_order_release);
+    return handle;
+  }
+
+  // nothing else to run, the slot is allowed to continue.
+  if (worker.next) {
+    return std::exchange(worker.next, nullptr);
+  }
+  return std::nullopt;
 }
 
 void MultiThreadExecutor::thread_function(std::size_t idx) {
-  while (!_shutdown_requested.load(std::memory_order_acquire) ||
-         _size.load(std::memory_order_acquire) > 0) {
+  current_worker = CurrentWorker{this, idx};
+
+  while (true) {
+    std::optional<std::coroutine_handle<>> handle{std::nullopt};
+    for (int i = 0; i < SPIN_ROUNDS && !handle; ++i) {
+      handle = next_handle(idx);
+      if (!handle && _size.load(std::memory_order_acquire) <= 0) {
+        break;
+      }
+    }
+
+    if (handle) {
+      detail::OutputCork cork{};
+      handle->resume();
+      continue;
+    }
+
     std::unique_lock lock(_wait_mutex);
+    _idle_workers.fetch_add(1, std::memory_order_seq_cst);
     _wait_cv.wait(lock, [&] {
-      return _size.load(std::memory_order_acquire) ||
+      return _size.load(std::memory_order_seq_cst) > 0 ||
              _shutdown_requested.load(std::memory_order_acquire);
     });
+    _idle_workers.fetch_sub(1, std::memory_order_relaxed);
 
-    while (!_handles.empty()) {
-      auto handle = _handles.front();
-      _handles.pop_front();
-
-      lock.unlock();
-      handle.resume();
-      _size.fetch_sub(1, std::memory_order_release);
-      lock.lock();
+    if (_shutdown_requested.load(std::memory_order_acquire) &&
+        _size.load(std::memory_order_acquire) <= 0) {
+      break;
     }
   }
+
+  current_worker = CurrentWorker{};
 }
 } // namespace libcoro
@@ -0,0 +1,115 @@
+#include "libcoro/output_queue.hpp"
+
+#include <cerrno>
+#include <utility>
+#include <sys/socket.h>
+
+namespace libcoro {
+namespace detail {
+namespace {
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = MSG_DONTWAIT;
+#endif
+
+// corks on this thread, nested when a turn resumes a coroutine inline.
+thread_local std::size_t cork_depth = 0;
+thread_local OutputQueue* corked = nullptr;
+} // namespace
+
+OutputCork::OutputCork() noexcept { ++cork_depth; }
+
+OutputCork::~OutputCork() {
+  if (--cork_depth > 0) {
+    return;
+  }
+  for (auto* output = std::exchange(corked, nullptr); output != nullptr;) {
+    auto* next = std::exchange(output->next_corked, nullptr);
+    output->request_flush(output->request_context, *output);
+    output = next;
+  }
+}
+
+bool OutputCork::hold(OutputQueue& output) noexcept {
+  if (cork_depth == 0) {
+    return false;
+  }
+  output.next_corked = corked;
+  corked = &output;
+  return true;
+}
+
+void OutputCork::release(OutputQueue& output) noexcept {
+  for (auto** link = &corked; *link != nullptr; link = &(*link)->next_corked) {
+    if (*link == &output) {
+      *link = std::exchange(output.next_corked, nullptr);
+      return;
+    }
+  }
+}
+
+OutputQueue::AppendResult OutputQueue::append(std::span<const char> data) {
+  std::scoped_lock lock(_mutex);
+  if (_buffer.size() + data.size() > _limit) {
+    return AppendResult::FULL;
+  }
+  _buffer.insert(_buffer.end(), data.begin(), data.end());
+  if (_flush_requested) {
+    return AppendResult::QUEUED;
+  }
+  _flush_requested = true;
+  return AppendResult::FLUSH_NEEDED;
+}
+
+int OutputQueue::take_error() noexcept {
+  std::scoped_lock lock(_mutex);
+  auto error = _error;
+  _error = 0;
+  return error;
+}
+
+void OutputQueue::flush() noexcept {
+  std::scoped_lock lock(_mutex);
+  write_out();
+  // later appends need a new request, unless this flush leaves data for write readiness.
+  _flush_requested = !_buffer.empty();
+}
+
+void OutputQueue::close() noexcept {
+  OutputCork::release(*this);
+  std::scoped_lock lock(_mutex);
+  write_out();
+  _buffer.clear();
+  _closed = true;
+}
+
+std::size_t OutputQueue::size() const {
+  std::scoped_lock lock(_mutex);
+  return _buffer.size();
+}
+
+void OutputQueue::write_out() noexcept {
+  if (_closed || _buffer.empty()) {
+    return;
+  }
+
+  std::size_t written = 0;
+  while (written < _buffer.size()) {
+    auto bytes = ::send(_fd, _buffer.data() + written, _buffer.size() - written, SEND_FLAGS);
+    if (bytes > 0) {
+      written += static_cast<std::size_t>(bytes);
+    } else if (bytes == -1 && errno == EINTR) {
+      continue;
+    } else if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // the rest goes out on the next write readiness.
+      break;
+    } else {
+      _error = bytes == 0 ? EPIPE : errno;
+      written = _buffer.size();
+    }
+  }
+  _buffer.erase(_buffer.begin(), _buffer.begin() + static_cast<std::ptrdiff_t>(written));
+}
+} // namespace detail
+} // namespace libcoro
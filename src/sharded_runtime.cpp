@@ -0,0 +1,76 @@
+#include "libcoro/sharded_runtime.hpp"
+#include <stdexcept>
+#include <sys/socket.h>
+
+namespace libcoro {
+ShardedRuntime::ShardedRuntime(std::size_t shards, bool pin_threads) {
+  if (shards == 0) {
+    throw std::invalid_argument("ShardedRuntime requires at least one shard");
+  }
+
+  _shards.reserve(shards);
+  for (std::size_t i = 0; i < shards; ++i) {
+    if (pin_threads) {
+      // the executor and the io thread hand work to each other, on separate cpus a wakeup does
+      // not have to preempt the other thread first.
+      auto executor = std::make_shared<executor_type>(2 * i);
+      _shards.emplace_back(std::make_shared<IOService<executor_type>>(executor, 2 * i + 1));
+    } else {
+      auto executor = std::make_shared<executor_type>();
+      _shards.emplace_back(std::make_shared<IOService<executor_type>>(executor));
+    }
+  }
+}
+
+ShardedRuntime::~ShardedRuntime() { close(); }
+
+void ShardedRuntime::close() {
+  for (auto& shard : _shards) {
+    shard->close();
+  }
+}
+
+std::vector<Socket<ShardedRuntime::executor_type>>
+create_socket(ShardedRuntime& runtime, socket::Family family, socket::Protocol protocol) {
+  std::vector<Socket<ShardedRuntime::executor_type>> sockets;
+  sockets.reserve(runtime.size());
+
+  for (std::size_t i = 0; i < runtime.size(); ++i) {
+    auto fd = detail::create_socket_fd(family, protocol);
+
+    socket::Options options{};
+    options.reuse_address = true;
+    options.reuse_port = true;
+    if (detail::apply_socket_options(fd, options) == -1) {
+      ::close(fd);
+      throw std::runtime_error("Failed to set SO_REUSEPORT");
+    }
+
+    sockets.emplace_back(runtime.shard(i), fd);
+  }
+
+  return sockets;
+}
+
+std::vector<Socket<ShardedRuntime::executor_type>>
+create_listener(ShardedRuntime& runtime, socket::Family family, socket::Protocol protocol,
+                const socket::IPAddress& address, int port, int backlog) {
+  auto sockets = create_socket(runtime, family, protocol);
+  for (auto& listener : sockets) {
+    if (listener.bind(port, address) == -1) {
+      throw std::runtime_error("Failed to bind socket");
+    }
+    if (port == 0) {
+      // the first bind picked a free port, the other shards join it there.
+      port = listener.local_port();
+      if (port == -1) {
+        throw std::runtime_error("Failed to get the bound port");
+      }
+    }
+    if (protocol == socket::Protocol::TCP && listener.listen(backlog) == -1) {
+      throw std::runtime_error("Failed to listen on socket");
+    }
+  }
+  return sockets;
+}
+} // namespace libcoro
@@ -1,32 +1,73 @@
 #include "libcoro/single_thread_executor.hpp"
+#include "libcoro/affinity.hpp"
+#include "libcoro/output_queue.hpp"
 #include <atomic>
 #include <mutex>
 
 namespace libcoro {
+namespace {
+// handles resumed per pass before the local queue and the overflow get another turn.
+constexpr std::size_t DRAIN_BATCH_SIZE = 256;
+} // namespace
+
 SingleThreadExecutor::SingleThreadExecutor()
     : _execute_thread(&SingleThreadExecutor::background_thread, this) {}
 
+SingleThreadExecutor::SingleThreadExecutor(std::size_t cpu): SingleThreadExecutor() {
+  detail::pin_thread(_execute_thread, cpu);
+}
+
 SingleThreadExecutor::~SingleThreadExecutor() { shutdown(); }
 
 void SingleThreadExecutor::resume(std::coroutine_handle<> handle) { execute(handle); }
 
+void SingleThreadExecutor::resume_batch(std::span<std::coroutine_handle<>> handles) {
+  std::int64_t queued = 0;
+  for (auto handle : handles) {
+    if (handle && enqueue(handle)) {
+      ++queued;
+    }
+  }
+  if (queued > 0) {
+    wake(queued);
+  }
+}
+
 void SingleThreadExecutor::execute(std::coroutine_handle<> handle) {
-  if (!handle) {
-    return;
+  if (handle && enqueue(handle)) {
+    wake(1);
   }
-  {
-    std::scoped_lock lock(_wait_mutex);
-    _handle = handle;
+}
+
+bool SingleThreadExecutor::enqueue(std::coroutine_handle<> handle) {
+  if (std::this_thread::get_id() == _execute_thread.get_id()) {
+    // woken from a coroutine running on this executor, no lock or signal is needed.
+    _local_handles.push_back(handle);
+    return false;
+  }
+
+  if (!_handles.try_push(handle)) {
+    std::scoped_lock lock(_overflow_mutex);
+    _overflow_handles.push_back(handle);
+    _has_overflow.store(true, std::memory_order_release);
+  }
+  return true;
+}
+
+void SingleThreadExecutor::wake(std::int64_t count) {
+  // pairs with park(): either the executor sees the new handles before sleeping, or we see it
+  // sleeping and wake it up.
+  _pending.fetch_add(count, std::memory_order_seq_cst);
+  if (_sleeping.load(std::memory_order_seq_cst) &&
+      _sleeping.exchange(false, std::memory_order_seq_cst)) {
+    _sleeping.notify_one();
   }
-  _wait_cv.notify_one();
 }
 
 void SingleThreadExecutor::shutdown() {
   if (_shutdown_requested.exchange(true, std::memory_order_acq_rel) == false) {
-    {
-      std::scoped_lock lock(_wait_mutex);
-      _wait_cv.notify_one();
-    }
+    _sleeping.store(false, std::memory_order_seq_cst);
+    _sleeping.notify_one();
 
     if (_execute_thread.joinable()) {
       _execute_thread.join();
@@ -34,20 +75,71 @@ void SingleThreadExecutor::shutdown() {
   }
 }
 
-void SingleThreadExecutor::background_thread() {
-  while (!_shutdown_requested.load(std::memory_order_acquire)) {
-    std::unique_lock lock(_wait_mutex);
-    _wait_cv.wait(lock, [&]() {
-      return static_cast<bool>(_handle) || _shutdown_requested.load(std::memory_order_acquire);
-    });
-
-    if (_handle) {
-      auto handle = _handle;
-      _handle = nullptr;
-      lock.unlock();
+std::size_t SingleThreadExecutor::drain() {
+  std::size_t count = 0;
+  while (count < DRAIN_BATCH_SIZE) {
+    auto handle = _handles.try_pop();
+    if (!handle) {
+      break;
+    }
+    ++count;
+    detail::OutputCork cork{};
+    handle->resume();
+  }
+
+  if (_has_overflow.load(std::memory_order_acquire)) {
+    std::deque<std::coroutine_handle<>> handles;
+    {
+      std::scoped_lock lock(_overflow_mutex);
+      handles.swap(_overflow_handles);
+      _has_overflow.store(false, std::memory_order_release);
+    }
+    for (auto handle : handles) {
+      ++count;
+      detail::OutputCork cork{};
       handle.resume();
-      lock.lock();
     }
   }
+
+  if (count > 0) {
+    _pending.fetch_sub(static_cast<std::int64_t>(count), std::memory_order_release);
+  }
+
+  // only run what was queued before this pass, handles waking each other have to wait for the
+  // next pass so external submissions still get their turn.
+  for (auto local = _local_handles.size(); local > 0; --local) {
+    auto handle = _local_handles.front();
+    _local_handles.pop_front();
+    ++count;
+    detail::OutputCork cork{};
+    handle.resume();
+  }
+
+  return count;
+}
+
+void SingleThreadExecutor::park() {
+  _sleeping.store(true, std::memory_order_seq_cst);
+  if (_pending.load(std::memory_order_seq_cst) > 0 || !_local_handles.empty() ||
+      _shutdown_requested.load(std::memory_order_acquire)) {
+    _sleeping.store(false, std::memory_order_relaxed);
+    return;
+  }
+  _sleeping.wait(true, std::memory_order_seq_cst);
+}
+
+void SingleThreadExecutor::background_thread() {
+  while (true) {
+    if (drain() > 0) {
+      continue;
+    }
+
+    if (_shutdown_requested.load(std::memory_order_acquire) &&
+        _pending.load(std::memory_order_acquire) <= 0 && _local_handles.empty()) {
+      break;
+    }
+
+    park();
+  }
 }
 } // namespace libcoro
@@ -0,0 +1,69 @@
+#include "libcoro/socket_options.hpp"
+
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace libcoro {
+namespace detail {
+namespace {
+int set_option(int fd, int level, int name, int value) noexcept {
+  return ::setsockopt(fd, level, name, &value, sizeof(value));
+}
+
+#ifndef __linux__
+int unsupported() noexcept {
+  errno = ENOPROTOOPT;
+  return -1;
+}
+#endif
+} // namespace
+
+int apply_socket_options(int fd, const socket::Options& options) noexcept {
+  if (options.no_delay && set_option(fd, IPPROTO_TCP, TCP_NODELAY, *options.no_delay) == -1) {
+    return -1;
+  }
+  if (options.receive_buffer &&
+      set_option(fd, SOL_SOCKET, SO_RCVBUF, *options.receive_buffer) == -1) {
+    return -1;
+  }
+  if (options.send_buffer && set_option(fd, SOL_SOCKET, SO_SNDBUF, *options.send_buffer) == -1) {
+    return -1;
+  }
+  if (options.reuse_address &&
+      set_option(fd, SOL_SOCKET, SO_REUSEADDR, *options.reuse_address) == -1) {
+    return -1;
+  }
+  if (options.reuse_port && set_option(fd, SOL_SOCKET, SO_REUSEPORT, *options.reuse_port) == -1) {
+    return -1;
+  }
+  if (options.fast_open && set_option(fd, IPPROTO_TCP, TCP_FASTOPEN, *options.fast_open) == -1) {
+    return -1;
+  }
+
+#ifdef __linux__
+  if (options.quick_ack && set_option(fd, IPPROTO_TCP, TCP_QUICKACK, *options.quick_ack) == -1) {
+    return -1;
+  }
+  if (options.busy_poll && set_option(fd, SOL_SOCKET, SO_BUSY_POLL, *options.busy_poll) == -1) {
+    return -1;
+  }
+  if (options.defer_accept &&
+      set_option(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, *options.defer_accept) == -1) {
+    return -1;
+  }
+  if (options.incoming_cpu &&
+      set_option(fd, SOL_SOCKET, SO_INCOMING_CPU, *options.incoming_cpu) == -1) {
+    return -1;
+  }
+#else
+  if (options.quick_ack || options.busy_poll || options.defer_accept || options.incoming_cpu) {
+    return unsupported();
+  }
+#endif
+
+  return 0;
+}
+} // namespace detail
+} // namespace libcoro
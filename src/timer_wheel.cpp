@@ -0,0 +1,139 @@
+#include "libcoro/timer_wheel.hpp"
+#include <limits>
+
+namespace libcoro {
+namespace detail {
+TimerWheel::TimerWheel(clock::time_point origin, clock::duration resolution)
+    : _origin(origin), _resolution(resolution) {
+  for (auto& level : _slots) {
+    for (auto& slot : level) {
+      slot.prev = &slot;
+      slot.next = &slot;
+    }
+  }
+}
+
+void TimerWheel::add(TimerNode& node, clock::time_point deadline) noexcept {
+  if (node.linked()) {
+    cancel(node);
+  }
+  node.deadline = ceil_tick(deadline);
+  // overdue entries go to the next tick, the current slot has been processed already.
+  insert(node, _now + 1);
+  ++_size;
+}
+
+void TimerWheel::cancel(TimerNode& node) noexcept {
+  if (node.linked()) {
+    unlink(node);
+    --_size;
+  }
+}
+
+std::optional<TimerWheel::clock::time_point> TimerWheel::next_expiry() const noexcept {
+  if (_size == 0) {
+    return std::nullopt;
+  }
+  return to_time_point(next_tick());
+}
+
+std::uint64_t TimerWheel::next_tick() const noexcept {
+  // level 0 holds the next 255 ticks, the first occupied slot is exact.
+  auto next = std::numeric_limits<std::uint64_t>::max();
+  for (std::uint64_t tick = _now + 1; tick < _now + SLOTS; ++tick) {
+    if (!slot_empty(_slots[0][slot_index(tick, 0)])) {
+      next = tick;
+      break;
+    }
+  }
+
+  // entries above are cascaded when the window of their slot begins, nothing in it is due
+  // earlier. the slot of the current window comes round again after a full rotation.
+  for (std::size_t level = 1; level < LEVELS; ++level) {
+    auto shift = level * SLOT_BITS;
+    auto window = _now >> shift;
+    for (std::uint64_t offset = 1; offset <= SLOTS; ++offset) {
+      auto start = (window + offset) << shift;
+      if (start >= next) {
+        break;
+      }
+      if (!slot_empty(_slots[level][(window + offset) & (SLOTS - 1)])) {
+        next = start;
+        break;
+      }
+    }
+  }
+  return next;
+}
+
+std::uint64_t TimerWheel::ceil_tick(clock::time_point time_point) const noexcept {
+  if (time_point <= _origin) {
+    return 0;
+  }
+  auto elapsed = time_point - _origin;
+  return static_cast<std::uint64_t>((elapsed + _resolution - clock::duration(1)) / _resolution);
+}
+
+std::uint64_t TimerWheel::floor_tick(clock::time_point time_point) const noexcept {
+  if (time_point <= _origin) {
+    return 0;
+  }
+  return static_cast<std::uint64_t>((time_point - _origin) / _resolution);
+}
+
+TimerWheel::clock::time_point TimerWheel::to_time_point(std::uint64_t tick) const noexcept {
+  return _origin + _resolution * static_cast<clock::rep>(tick);
+}
+
+void TimerWheel::insert(TimerNode& node, std::uint64_t earliest) noexcept {
+  auto deadline = node.deadline > earliest ? node.deadline : earliest;
+  auto delta = deadline - _now;
+
+  std::size_t level = 0;
+  while (level + 1 < LEVELS && delta >= (std::uint64_t{1} << ((level + 1) * SLOT_BITS))) {
+    ++level;
+  }
+  // beyond the wheel's range, park it on the last level, it's re-inserted when cascaded.
+  if (level + 1 == LEVELS && delta >= (std::uint64_t{1} << (LEVELS * SLOT_BITS))) {
+    deadline = _now + (std::uint64_t{1} << (LEVELS * SLOT_BITS)) - 1;
+  }
+
+  link(_slots[level][slot_index(deadline, level)], node);
+}
+
+void TimerWheel::cascade(std::size_t level) noexcept {
+  auto& slot = _slots[level][slot_index(_now, level)];
+  // detach the whole list first, re-inserted entries may land in this very slot again.
+  if (slot_empty(slot)) {
+    return;
+  }
+  auto* node = slot.next;
+  slot.prev->next = nullptr;
+  slot.prev = &slot;
+  slot.next = &slot;
+
+  while (node != nullptr) {
+    auto* next = node->next;
+    node->prev = nullptr;
+    node->next = nullptr;
+    // the slot of the current tick is expired right after cascading.
+    insert(*node, _now);
+    node = next;
+  }
+}
+
+void TimerWheel::link(Slot& slot, TimerNode& node) noexcept {
+  node.prev = slot.prev;
+  node.next = &slot;
+  slot.prev->next = &node;
+  slot.prev = &node;
+}
+
+void TimerWheel::unlink(TimerNode& node) noexcept {
+  node.prev->next = node.next;
+  node.next->prev = node.prev;
+  node.prev = nullptr;
+  node.next = nullptr;
+}
+} // namespace detail
+} // namespace libcoro
@@ -0,0 +1,56 @@
+#include "libcoro/zerocopy.hpp"
+
+#ifdef __linux__
+
+// linux/errqueue.h needs struct timespec declared first.
+#include <ctime>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace libcoro {
+namespace detail {
+bool enable_zerocopy(int fd) noexcept {
+  int enable = 1;
+  return ::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) == 0;
+}
+
+ZerocopyHarvest harvest_zerocopy(int fd) noexcept {
+  ZerocopyHarvest harvest{};
+
+  while (true) {
+    alignas(struct cmsghdr) char control[128];
+    struct msghdr message {};
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    if (::recvmsg(fd, &message, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+      // EAGAIN once the queue is empty.
+      break;
+    }
+
+    for (auto* cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&message, cmsg)) {
+      bool recverr = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                     (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+      if (!recverr) {
+        continue;
+      }
+
+      auto* error = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cmsg));
+      if (error->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        harvest.error = true;
+        continue;
+      }
+      // notifications cover the range [ee_info, ee_data] and arrive in order on a stream.
+      harvest.completed = true;
+      harvest.released = error->ee_data + 1;
+    }
+  }
+
+  return harvest;
+}
+} // namespace detail
+} // namespace libcoro
+
+#endif // __linux__
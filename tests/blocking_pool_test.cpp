@@ -0,0 +1,56 @@
+#include "libcoro/blocking_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <latch>
+#include <thread>
+#include <vector>
+
+namespace {
+// blocks until `count` jobs run at once, or gives up after a while.
+struct RendezvousJob : libcoro::detail::BlockingJob {
+  RendezvousJob(std::atomic<int>& running, std::latch& done, int count)
+      : running(running), done(done), count(count) {
+    run = [](libcoro::detail::BlockingJob* job) noexcept {
+      auto& self = *static_cast<RendezvousJob*>(job);
+      self.running.fetch_add(1);
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+      while (self.running.load() < self.count && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      self.met = self.running.load() >= self.count;
+      self.done.count_down();
+    };
+  }
+
+  std::atomic<int>& running;
+  std::latch& done;
+  int count;
+  bool met{false};
+};
+} // namespace
+
+TEST(BlockingPoolTest, BurstDoesNotCountClaimedIdleThreads) {
+  libcoro::detail::BlockingPool pool{};
+
+  // leaves idle threads behind, which the burst below claims faster than they wake up.
+  for (int round : {2, 16}) {
+    std::atomic<int> running{0};
+    std::latch done{round};
+    std::vector<RendezvousJob> jobs;
+    jobs.reserve(static_cast<std::size_t>(round));
+    for (int i = 0; i < round; ++i) {
+      jobs.emplace_back(running, done, round);
+    }
+    for (auto& job : jobs) {
+      pool.submit(job);
+    }
+    done.wait();
+    for (auto& job : jobs) {
+      EXPECT_TRUE(job.met);
+    }
+  }
+  EXPECT_GE(pool.threads(), 16u);
+
+  pool.shutdown();
+}
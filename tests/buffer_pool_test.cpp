@@ -0,0 +1,38 @@
+#include "libcoro/buffer_pool.hpp"
+#include <gtest/gtest.h>
+#include <utility>
+
+TEST(BufferPoolTest, ReusesReturnedBuffers) {
+  libcoro::detail::BufferPool pool{};
+
+  char* first = nullptr;
+  {
+    auto lease = pool.acquire(1000);
+    ASSERT_TRUE(lease);
+    EXPECT_EQ(lease.size(), 1000u);
+    EXPECT_EQ(lease.capacity(), 1024u);
+    first = lease.data();
+  }
+
+  // same size class, the warm buffer comes back.
+  auto lease = pool.acquire(600);
+  EXPECT_EQ(lease.data(), first);
+  EXPECT_EQ(lease.capacity(), 1024u);
+
+  lease.resize(10);
+  EXPECT_EQ(lease.span().size(), 10u);
+}
+
+TEST(BufferPoolTest, LeasesMove) {
+  libcoro::detail::BufferPool pool{};
+
+  auto lease = pool.acquire(100);
+  auto* data = lease.data();
+  auto moved = std::move(lease);
+  EXPECT_FALSE(lease);
+  EXPECT_EQ(moved.data(), data);
+
+  // oversized requests bypass the classes.
+  auto large = pool.acquire(libcoro::detail::BufferPool::MAX_BUFFER_SIZE + 1);
+  EXPECT_EQ(large.capacity(), libcoro::detail::BufferPool::MAX_BUFFER_SIZE + 1);
+}
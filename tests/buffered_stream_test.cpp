@@ -0,0 +1,128 @@
+#include "libcoro/buffered_stream.hpp"
+#include "libcoro/byte_search.hpp"
+#include "libcoro/io_service.hpp"
+#include "libcoro/single_thread_executor.hpp"
+#include "libcoro/socket.hpp"
+#include "libcoro/sync.hpp"
+#include <array>
+#include <gtest/gtest.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+using executor_type = libcoro::SingleThreadExecutor;
+} // namespace
+
+TEST(BufferedStreamTest, FindsBytesAcrossVectorWidths) {
+  for (std::size_t size : {0, 1, 15, 16, 17, 31, 32, 33, 64, 100}) {
+    std::string data(size, 'x');
+    EXPECT_EQ(libcoro::detail::find_byte(data, '\n'), std::string_view::npos);
+    for (std::size_t i = 0; i < size; ++i) {
+      data.assign(size, 'x');
+      data[i] = '\n';
+      ASSERT_EQ(libcoro::detail::find_byte(data, '\n'), i) << "size " << size;
+    }
+  }
+
+  EXPECT_EQ(libcoro::detail::find_delimiter("a\rb\r\nc", "\r\n"), 3u);
+  EXPECT_EQ(libcoro::detail::find_delimiter("abc\r", "\r\n"), std::string_view::npos);
+  EXPECT_EQ(libcoro::detail::find_delimiter("--x---y", "---"), 3u);
+}
+
+TEST(BufferedStreamTest, ReadsLinesAndFramesFromSocket) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  libcoro::Socket<executor_type> left{io_service, fds[0]};
+  libcoro::Socket<executor_type> right{io_service, fds[1]};
+
+  auto exchange = [&]() -> libcoro::Task<std::vector<std::string>> {
+    libcoro::BufferedWriter writer{left, 64};
+    // small writes are coalesced, the frame is larger than the buffer and goes straight out.
+    EXPECT_EQ(co_await writer.write(std::string_view("first\r\n")),
+              libcoro::socket::TransferStatus::OK);
+    EXPECT_EQ(co_await writer.write(std::string_view("second\n")),
+              libcoro::socket::TransferStatus::OK);
+    EXPECT_EQ(writer.buffered(), 14u);
+    EXPECT_EQ(co_await writer.write(std::string(100, 'f')), libcoro::socket::TransferStatus::OK);
+    EXPECT_EQ(co_await writer.write(std::string_view("END")), libcoro::socket::TransferStatus::OK);
+    EXPECT_EQ(co_await writer.flush(), libcoro::socket::TransferStatus::OK);
+
+    std::vector<std::string> parts;
+    libcoro::BufferedReader reader{right, 32};
+    auto [first_status, first] = co_await reader.read_line();
+    parts.emplace_back(first);
+    auto [second_status, second] = co_await reader.read_line();
+    parts.emplace_back(second);
+
+    std::string frame(100, '\0');
+    EXPECT_EQ(co_await reader.read_exact(frame), libcoro::socket::TransferStatus::OK);
+    parts.push_back(frame);
+
+    std::array<char, 3> tail;
+    EXPECT_EQ(co_await reader.read_exact(tail), libcoro::socket::TransferStatus::OK);
+    parts.emplace_back(tail.data(), tail.size());
+    co_return parts;
+  };
+
+  auto parts = libcoro::sync(exchange());
+  ASSERT_EQ(parts.size(), 4u);
+  EXPECT_EQ(parts[0], "first");
+  EXPECT_EQ(parts[1], "second");
+  EXPECT_EQ(parts[2], std::string(100, 'f'));
+  EXPECT_EQ(parts[3], "END");
+
+  left.close();
+  right.close();
+  io_service->close();
+}
+
+TEST(BufferedStreamTest, LineLongerThanBufferFails) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  libcoro::Socket<executor_type> right{io_service, fds[1]};
+  std::string line(64, 'l');
+  ASSERT_EQ(::write(fds[0], line.data(), line.size()), static_cast<ssize_t>(line.size()));
+
+  libcoro::BufferedReader reader{right, 32};
+  auto [status, view] = libcoro::sync(reader.read_line());
+  EXPECT_EQ(status, libcoro::socket::TransferStatus::MESSAGE_SIZE);
+  EXPECT_TRUE(view.empty());
+
+  ::close(fds[0]);
+  right.close();
+  io_service->close();
+}
+
+TEST(BufferedStreamTest, LastLineWithoutNewlineIsReturned) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  libcoro::Socket<executor_type> right{io_service, fds[1]};
+  std::string data("first\nlast");
+  ASSERT_EQ(::write(fds[0], data.data(), data.size()), static_cast<ssize_t>(data.size()));
+  ::close(fds[0]);
+
+  libcoro::BufferedReader reader{right, 32};
+  auto [first_status, first] = libcoro::sync(reader.read_line());
+  EXPECT_EQ(first_status, libcoro::socket::TransferStatus::OK);
+  EXPECT_EQ(first, "first");
+  auto [last_status, last] = libcoro::sync(reader.read_line());
+  EXPECT_EQ(last_status, libcoro::socket::TransferStatus::OK);
+  EXPECT_EQ(last, "last");
+  auto [end_status, end] = libcoro::sync(reader.read_line());
+  EXPECT_EQ(end_status, libcoro::socket::TransferStatus::CLOSED);
+  EXPECT_TRUE(end.empty());
+
+  right.close();
+  io_service->close();
+}
@@ -0,0 +1,121 @@
+#include "libcoro/connection_pool.hpp"
+#include "libcoro/io_service.hpp"
+#include "libcoro/single_thread_executor.hpp"
+#include "libcoro/sync.hpp"
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+using executor_type = libcoro::SingleThreadExecutor;
+using pool_type = libcoro::ConnectionPool<executor_type>;
+
+// a loopback listener whose connections stay in the backlog, connect succeeds without accept.
+struct Listener {
+  Listener() {
+    fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    ::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    ::listen(fd, 16);
+    ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len);
+    port = ntohs(addr.sin_port);
+  }
+  ~Listener() { ::close(fd); }
+
+  int fd{-1};
+  int port{0};
+};
+} // namespace
+
+TEST(ConnectionPoolTest, ReusesReturnedConnections) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+  Listener listener;
+  auto address =
+      libcoro::socket::IPAddress::from_string("127.0.0.1", libcoro::socket::Family::IPV4);
+
+  {
+    pool_type pool{io_service};
+    auto use = [&]() -> libcoro::Task<void> {
+      {
+        auto [status, lease] = co_await pool.checkout(address, listener.port);
+        EXPECT_EQ(status, libcoro::socket::ConnectStatus::CONENCTED);
+        EXPECT_TRUE(lease);
+      }
+      EXPECT_EQ(pool.idle(), 1u);
+
+      auto [status, lease] = co_await pool.checkout(address, listener.port);
+      EXPECT_EQ(status, libcoro::socket::ConnectStatus::CONENCTED);
+      // the idle connection was taken rather than a new one opened.
+      EXPECT_EQ(pool.idle(), 0u);
+      lease.discard();
+    };
+    libcoro::sync(use());
+    EXPECT_EQ(pool.idle(), 0u);
+  }
+
+  io_service->close();
+}
+
+TEST(ConnectionPoolTest, CheckoutWaitsWhenExhausted) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+  Listener listener;
+  auto address =
+      libcoro::socket::IPAddress::from_string("127.0.0.1", libcoro::socket::Family::IPV4);
+
+  {
+    libcoro::ConnectionPoolOptions options{};
+    options.max_connections = 1;
+    pool_type pool{io_service, options};
+
+    auto first = libcoro::sync(pool.checkout(address, listener.port));
+    ASSERT_EQ(first.first, libcoro::socket::ConnectStatus::CONENCTED);
+
+    std::atomic<bool> checked_out{false};
+    std::thread waiter([&]() {
+      auto second = libcoro::sync(pool.checkout(address, listener.port));
+      EXPECT_EQ(second.first, libcoro::socket::ConnectStatus::CONENCTED);
+      checked_out.store(true);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(checked_out.load());
+    // handing the lease back resumes the waiting checkout with the same connection.
+    first.second = pool_type::Lease{};
+    waiter.join();
+    EXPECT_TRUE(checked_out.load());
+  }
+
+  io_service->close();
+}
+
+TEST(ConnectionPoolTest, EvictsIdleConnections) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+  Listener listener;
+  auto address =
+      libcoro::socket::IPAddress::from_string("127.0.0.1", libcoro::socket::Family::IPV4);
+
+  {
+    libcoro::ConnectionPoolOptions options{};
+    options.idle_timeout = std::chrono::milliseconds(10);
+    pool_type pool{io_service, options};
+
+    {
+      auto lease = libcoro::sync(pool.checkout(address, listener.port));
+      ASSERT_EQ(lease.first, libcoro::socket::ConnectStatus::CONENCTED);
+    }
+    EXPECT_EQ(pool.idle(), 1u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(pool.evict_idle(), 1u);
+    EXPECT_EQ(pool.idle(), 0u);
+  }
+
+  io_service->close();
+}
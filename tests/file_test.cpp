@@ -0,0 +1,285 @@
+#include "libcoro/append_log.hpp"
+#include "libcoro/file.hpp"
+#include "libcoro/io_service.hpp"
+#include "libcoro/mapped_file.hpp"
+#include "libcoro/single_thread_executor.hpp"
+#include "libcoro/sync.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <latch>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+using executor_type = libcoro::SingleThreadExecutor;
+
+// a fresh file under /var/tmp, which unlike /tmp is rarely tmpfs and so supports O_DIRECT.
+std::string temporary_path() {
+  char path[] = "/var/tmp/libcoro_file_XXXXXX";
+  auto fd = ::mkstemp(path);
+  if (fd == -1) {
+    return {};
+  }
+  ::close(fd);
+  return path;
+}
+} // namespace
+
+TEST(FileTest, PositionalAndSequentialAccess) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+  auto path = temporary_path();
+  ASSERT_FALSE(path.empty());
+
+  auto file = libcoro::open(io_service, path.c_str(), O_RDWR);
+  ASSERT_NE(file.fd(), -1);
+
+  auto run = [&]() -> libcoro::Task<std::string> {
+    EXPECT_EQ(co_await file.write(std::string_view("hello ")), 6);
+    EXPECT_EQ(co_await file.write(std::string_view("world")), 5);
+    // positional writes leave the file position alone.
+    EXPECT_EQ(co_await file.write(std::string_view("W"), 6), 1);
+
+    std::string tail(5, '\0');
+    EXPECT_EQ(co_await file.read(tail, 6), 5);
+    EXPECT_EQ(co_await file.read(tail), 0);
+
+    auto head = co_await file.read(5, 0);
+    std::string result(head.data(), head.size());
+    std::free(head.data());
+    co_return result + "|" + tail;
+  };
+
+  EXPECT_EQ(libcoro::sync(run()), "hello|World");
+
+  // the allocating read without an offset is sequential as well.
+  auto reread = libcoro::open(io_service, path.c_str(), O_RDONLY);
+  auto sequential = [&]() -> libcoro::Task<std::string> {
+    auto first = co_await reread.read(6);
+    auto second = co_await reread.read(16);
+    std::string result = std::string(first.data(), first.size()) + "|" +
+                         std::string(second.data(), second.size());
+    std::free(first.data());
+    std::free(second.data());
+    co_return result;
+  };
+  EXPECT_EQ(libcoro::sync(sequential()), "hello |World");
+
+  // errors come back as -errno instead of looking like the end of the file.
+  EXPECT_EQ(libcoro::sync(reread.write(std::string_view("x"))), -EBADF);
+
+  reread.close();
+  file.close();
+  ::unlink(path.c_str());
+  io_service->close();
+}
+
+#ifdef LIBCORO_IO_URING
+TEST(FileTest, ReadWriteOverIOUring) {
+  if (!libcoro::detail::IOUring::supported()) {
+    GTEST_SKIP() << "io_uring is not available";
+  }
+  auto executor = std::make_shared<executor_type>();
+  auto io_service =
+      std::make_shared<libcoro::IOService<executor_type>>(executor, libcoro::IOBackend::IO_URING);
+  ASSERT_TRUE(io_service->io_uring_enabled());
+  auto path = temporary_path();
+  ASSERT_FALSE(path.empty());
+
+  auto file = libcoro::open(io_service, path.c_str(), O_RDWR);
+  ASSERT_NE(file.fd(), -1);
+
+  std::string content(3 * 4096 + 17, 'r');
+  content.replace(4096, 4, "ring");
+  auto run = [&]() -> libcoro::Task<std::string> {
+    EXPECT_EQ(co_await file.write(content), static_cast<::ssize_t>(content.size()));
+    std::string read(content.size(), '\0');
+    EXPECT_EQ(co_await file.read(read, 0), static_cast<::ssize_t>(content.size()));
+    // past the end of the file.
+    EXPECT_EQ(co_await file.read(read, static_cast<::off_t>(content.size())), 0);
+    co_return read;
+  };
+  EXPECT_EQ(libcoro::sync(run()), content);
+
+  file.close();
+  ::unlink(path.c_str());
+  io_service->close();
+}
+#endif
+
+TEST(FileTest, DirectIOWithAlignedBuffers) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+  auto path = temporary_path();
+  ASSERT_FALSE(path.empty());
+
+  auto file = libcoro::open(io_service, path.c_str(), O_RDWR | O_DIRECT);
+  if (file.fd() == -1) {
+    auto error = errno;
+    ::unlink(path.c_str());
+    io_service->close();
+    if (error == EINVAL) {
+      GTEST_SKIP() << "the file system does not support O_DIRECT";
+    }
+    FAIL() << std::strerror(error);
+  }
+
+  constexpr auto block = libcoro::file::DIRECT_IO_ALIGNMENT;
+  auto out = libcoro::file::allocate_aligned(2 * block);
+  auto in = libcoro::file::allocate_aligned(block);
+  std::memset(out.get(), 'a', block);
+  std::memset(out.get() + block, 'b', block);
+
+  auto run = [&]() -> libcoro::Task<::ssize_t> {
+    EXPECT_EQ(co_await file.write(std::span<const char>(out.get(), 2 * block), 0),
+              static_cast<::ssize_t>(2 * block));
+    co_return co_await file.read(std::span<char>(in.get(), block), block);
+  };
+
+  EXPECT_EQ(libcoro::sync(run()), static_cast<::ssize_t>(block));
+  EXPECT_EQ(std::string_view(in.get(), block), std::string(block, 'b'));
+
+  file.close();
+  ::unlink(path.c_str());
+  io_service->close();
+}
+
+TEST(FileTest, MappedFileViewsAndPrefetch) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+  auto path = temporary_path();
+  ASSERT_FALSE(path.empty());
+
+  std::string content(3 * 4096 + 100, 'm');
+  content.replace(4096, 4, "page");
+  {
+    auto file = libcoro::open(io_service, path.c_str(), O_WRONLY);
+    ASSERT_EQ(libcoro::sync(file.write(content)), static_cast<::ssize_t>(content.size()));
+  }
+
+  auto mapped = libcoro::map_file(io_service, path.c_str());
+  ASSERT_EQ(mapped.size(), content.size());
+  // clamped at the end of the file.
+  EXPECT_EQ(mapped.view(content.size() - 10, 100).size(), 10u);
+
+  auto range = mapped.view(4096, 4);
+  libcoro::sync(mapped.prefetch(range));
+  EXPECT_EQ(std::string_view(range.data(), range.size()), "page");
+  libcoro::sync(mapped.prefetch(mapped.data()));
+  EXPECT_EQ(std::string_view(mapped.data().data(), mapped.size()), content);
+
+  mapped.close();
+  EXPECT_TRUE(mapped.data().empty());
+  ::unlink(path.c_str());
+  io_service->close();
+}
+
+TEST(FileTest, AppendLogGroupsConcurrentAppends) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+  auto path = temporary_path();
+  ASSERT_FALSE(path.empty());
+
+  // the window lets every append below join the first batch, except for the size limit.
+  libcoro::AppendLogOptions options{};
+  options.max_batch_appends = 8;
+  options.max_delay = std::chrono::milliseconds(50);
+  libcoro::AppendLog log{io_service, libcoro::open(io_service, path.c_str(), O_RDWR), options};
+
+  constexpr int appends = 16;
+  std::vector<std::string> records;
+  for (int i = 0; i < appends; ++i) {
+    records.push_back("record " + std::to_string(i) + "\n");
+  }
+  std::vector<::off_t> offsets(appends, -1);
+  std::latch done{appends};
+  auto append = [&](int i) -> libcoro::Task<void> {
+    offsets[i] = co_await log.append(records[i]);
+    done.count_down();
+  };
+  for (int i = 0; i < appends; ++i) {
+    io_service->execute(append(i));
+  }
+  done.wait();
+
+  EXPECT_EQ(log.batches(), 2u);
+  auto file = libcoro::open(io_service, path.c_str(), O_RDONLY);
+  for (int i = 0; i < appends; ++i) {
+    ASSERT_NE(offsets[i], -1);
+    std::string stored(records[i].size(), '\0');
+    EXPECT_EQ(libcoro::sync(file.read(stored, offsets[i])),
+              static_cast<::ssize_t>(stored.size()));
+    EXPECT_EQ(stored, records[i]);
+  }
+
+  file.close();
+  ::unlink(path.c_str());
+  io_service->close();
+}
+
+TEST(FileTest, ChunksReadAheadThroughTheFile) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+  auto path = temporary_path();
+  ASSERT_FALSE(path.empty());
+
+  std::string content;
+  for (int i = 0; content.size() < 10 * 4096 + 123; ++i) {
+    content += std::to_string(i) + ",";
+  }
+  content.resize(10 * 4096 + 123);
+  auto file = libcoro::open(io_service, path.c_str(), O_RDWR);
+  ASSERT_EQ(libcoro::sync(file.write(content)), static_cast<::ssize_t>(content.size()));
+
+  auto chunks = file.chunks(4096, 3);
+  // the generator reads through its own descriptor.
+  file.close();
+
+  auto run = [&]() -> libcoro::Task<std::vector<std::string>> {
+    std::vector<std::string> read;
+    while (auto chunk = co_await chunks.next()) {
+      read.emplace_back(chunk->data(), chunk->size());
+    }
+    co_return read;
+  };
+
+  auto read = libcoro::sync(run());
+  ASSERT_EQ(read.size(), 11u);
+  EXPECT_EQ(read.back().size(), 123u);
+  std::string joined;
+  for (auto& chunk : read) {
+    joined += chunk;
+  }
+  EXPECT_EQ(joined, content);
+
+  ::unlink(path.c_str());
+  io_service->close();
+}
+
+TEST(FileTest, ChunksSurfaceReadErrors) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  // reading a directory fails with EISDIR, which must not pass for the end of the file.
+  auto directory = libcoro::open(io_service, "/var/tmp", O_RDONLY | O_DIRECTORY);
+  ASSERT_NE(directory.fd(), -1);
+  auto chunks = directory.chunks(4096);
+  directory.close();
+
+  auto run = [&]() -> libcoro::Task<std::size_t> {
+    std::size_t read = 0;
+    while (co_await chunks.next()) {
+      ++read;
+    }
+    co_return read;
+  };
+  EXPECT_THROW(libcoro::sync(run()), std::runtime_error);
+
+  io_service->close();
+}
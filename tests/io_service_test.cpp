@@ -0,0 +1,724 @@
+#include "libcoro/file.hpp"
+#include "libcoro/io_service.hpp"
+#include "libcoro/single_thread_executor.hpp"
+#include "libcoro/socket.hpp"
+#include "libcoro/sync.hpp"
+#include "libcoro/transfer.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <gtest/gtest.h>
+#include <latch>
+#include <netinet/in.h>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+using executor_type = libcoro::SingleThreadExecutor;
+using io_service_ptr = std::shared_ptr<libcoro::IOService<executor_type>>;
+
+libcoro::Task<std::string> echo(libcoro::Socket<executor_type>& writer,
+                                libcoro::Socket<executor_type>& reader, std::string_view message) {
+  auto [send_status, sent] = co_await writer.send(message);
+  if (send_status != libcoro::socket::TransferStatus::OK || sent != message.size()) {
+    co_return std::string{};
+  }
+
+  std::string received;
+  while (received.size() < message.size()) {
+    auto [status, data] = co_await reader.recieve(message.size() - received.size());
+    if (status != libcoro::socket::TransferStatus::OK) {
+      break;
+    }
+    received.append(data.data(), data.size());
+    std::free(data.data());
+  }
+  co_return received;
+}
+
+libcoro::Task<void> receive_into(libcoro::Socket<executor_type>& reader,
+                                 std::promise<std::string>& result) {
+  auto [status, data] = co_await reader.recieve(16);
+  result.set_value(status == libcoro::socket::TransferStatus::OK
+                       ? std::string(data.data(), data.size())
+                       : std::string{});
+  std::free(data.data());
+}
+
+void run_echo(libcoro::IOBackend backend) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor, backend);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  libcoro::Socket<executor_type> left{io_service, fds[0]};
+  libcoro::Socket<executor_type> right{io_service, fds[1]};
+
+  EXPECT_EQ(libcoro::sync(echo(left, right, "hello")), "hello");
+  EXPECT_EQ(libcoro::sync(echo(right, left, "world")), "world");
+
+  left.close();
+  right.close();
+  io_service->close();
+}
+
+void run_receive_waits(libcoro::IOBackend backend) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor, backend);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  libcoro::Socket<executor_type> reader{io_service, fds[0]};
+
+  std::promise<std::string> result;
+  auto future = result.get_future();
+  io_service->execute(receive_into(reader, result));
+
+  // give the reader time to park on the empty socket.
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_EQ(::write(fds[1], "ping", 4), 4);
+
+  ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  EXPECT_EQ(future.get(), "ping");
+
+  reader.close();
+  ::close(fds[1]);
+  io_service->close();
+}
+
+void run_close_resumes(libcoro::IOBackend backend) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor, backend);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  libcoro::Socket<executor_type> reader{io_service, fds[0]};
+  libcoro::Socket<executor_type> writer{io_service, fds[1]};
+
+  std::promise<libcoro::socket::TransferStatus> received;
+  std::promise<libcoro::detail::PollStatus> polled;
+  auto receive = [&]() -> libcoro::Task<void> {
+    char buffer[16];
+    auto [status, bytes] = co_await reader.recieve(std::span<char>(buffer, sizeof(buffer)));
+    received.set_value(status);
+  };
+  auto poll = [&]() -> libcoro::Task<void> {
+    polled.set_value(co_await writer.poll(libcoro::detail::PollType::READ,
+                                          std::chrono::seconds(30)));
+  };
+  io_service->execute(receive());
+  io_service->execute(poll());
+
+  // give both time to park, neither socket ever turns readable. closed from the executor thread
+  // like any other coroutine would.
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  auto close = [&]() -> libcoro::Task<void> {
+    reader.close();
+    writer.close();
+    co_return;
+  };
+  io_service->execute(close());
+
+  auto received_status = received.get_future();
+  auto polled_status = polled.get_future();
+  ASSERT_EQ(received_status.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  ASSERT_EQ(polled_status.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  EXPECT_NE(received_status.get(), libcoro::socket::TransferStatus::OK);
+  EXPECT_EQ(polled_status.get(), libcoro::detail::PollStatus::EVENT_CLOSED);
+  // returns only once nothing is awaited anymore.
+  io_service->close();
+}
+} // namespace
+
+TEST(IOServiceTest, EchoOverEpoll) { run_echo(libcoro::IOBackend::EPOLL); }
+
+#ifdef LIBCORO_IO_URING
+TEST(IOServiceTest, EchoOverIOUring) {
+  if (!libcoro::detail::IOUring::supported()) {
+    GTEST_SKIP() << "io_uring is not available";
+  }
+  run_echo(libcoro::IOBackend::IO_URING);
+}
+#endif
+
+TEST(IOServiceTest, ReceiveWaitsForReadiness) { run_receive_waits(libcoro::IOBackend::EPOLL); }
+
+#ifdef LIBCORO_IO_URING
+// the receive is parked on the ring before the peer writes.
+TEST(IOServiceTest, ReceiveWaitsOverIOUring) {
+  if (!libcoro::detail::IOUring::supported()) {
+    GTEST_SKIP() << "io_uring is not available";
+  }
+  run_receive_waits(libcoro::IOBackend::IO_URING);
+}
+#endif
+
+TEST(IOServiceTest, CloseResumesParkedWaiters) { run_close_resumes(libcoro::IOBackend::EPOLL); }
+
+#ifdef LIBCORO_IO_URING
+// the receive is in flight on the ring, closing the socket cancels it.
+TEST(IOServiceTest, CloseResumesParkedWaitersOverIOUring) {
+  if (!libcoro::detail::IOUring::supported()) {
+    GTEST_SKIP() << "io_uring is not available";
+  }
+  run_close_resumes(libcoro::IOBackend::IO_URING);
+}
+#endif
+
+TEST(IOServiceTest, SleepFor) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  auto start = std::chrono::steady_clock::now();
+  libcoro::sync([](io_service_ptr io_service) -> libcoro::Task<void> {
+    co_await io_service->sleep_for(std::chrono::milliseconds(20));
+  }(io_service));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+  io_service->close();
+}
+
+TEST(IOServiceTest, PollTimesOut) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  libcoro::Socket<executor_type> reader{io_service, fds[0]};
+
+  auto status =
+      libcoro::sync(reader.poll(libcoro::detail::PollType::READ, std::chrono::milliseconds(10)));
+  EXPECT_EQ(status, libcoro::detail::PollStatus::EVENT_TIMEOUT);
+
+  ASSERT_EQ(::write(fds[1], "ping", 4), 4);
+  status = libcoro::sync(reader.poll(libcoro::detail::PollType::READ, std::chrono::seconds(5)));
+  EXPECT_EQ(status, libcoro::detail::PollStatus::EVENT_READY);
+
+  reader.close();
+  ::close(fds[1]);
+  io_service->close();
+}
+
+TEST(IOServiceTest, ScheduleFromManyThreads) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  constexpr int threads = 4;
+  constexpr int tasks_per_thread = 1000;
+  std::atomic<int> completed{0};
+  std::latch done{threads * tasks_per_thread};
+
+  auto task = [](std::atomic<int>& completed, std::latch& done) -> libcoro::Task<void> {
+    completed.fetch_add(1, std::memory_order_relaxed);
+    done.count_down();
+    co_return;
+  };
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < threads; ++i) {
+    producers.emplace_back([&]() {
+      for (int j = 0; j < tasks_per_thread; ++j) {
+        io_service->execute(task(completed, done));
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+
+  done.wait();
+  EXPECT_EQ(completed.load(), threads * tasks_per_thread);
+  io_service->close();
+}
+
+TEST(IOServiceTest, OneShotPollOnUnregisteredFd) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  int fds[2];
+  ASSERT_EQ(::pipe(fds), 0);
+  ASSERT_EQ(::write(fds[1], "x", 1), 1);
+  auto status = libcoro::sync(
+      [](io_service_ptr io_service, int fd) -> libcoro::Task<libcoro::detail::PollStatus> {
+        co_return co_await io_service->poll(fd, libcoro::detail::PollType::READ);
+      }(io_service, fds[0]));
+  EXPECT_EQ(status, libcoro::detail::PollStatus::EVENT_READY);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+  io_service->close();
+}
+
+TEST(IOServiceTest, ReceiveIntoCallerAndPooledBuffers) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  libcoro::Socket<executor_type> reader{io_service, fds[0]};
+
+  ASSERT_EQ(::write(fds[1], "hello", 5), 5);
+  char buffer[16];
+  auto [status, bytes] = libcoro::sync(reader.recieve(std::span<char>(buffer)));
+  EXPECT_EQ(status, libcoro::socket::TransferStatus::OK);
+  EXPECT_EQ(std::string_view(buffer, bytes), "hello");
+
+  ASSERT_EQ(::write(fds[1], "world", 5), 5);
+  auto [pooled_status, lease] = libcoro::sync(reader.recieve_pooled(512));
+  EXPECT_EQ(pooled_status, libcoro::socket::TransferStatus::OK);
+  EXPECT_EQ(std::string_view(lease.data(), lease.size()), "world");
+
+  reader.close();
+  ::close(fds[1]);
+  io_service->close();
+}
+
+TEST(IOServiceTest, VectoredTransfer) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  libcoro::Socket<executor_type> left{io_service, fds[0]};
+  libcoro::Socket<executor_type> right{io_service, fds[1]};
+
+  std::string_view header = "head:";
+  std::string_view body = "body";
+  std::array<std::span<const char>, 2> out{header, body};
+  auto [send_status, sent] = libcoro::sync(left.sendv(out));
+  EXPECT_EQ(send_status, libcoro::socket::TransferStatus::OK);
+  EXPECT_EQ(sent, header.size() + body.size());
+
+  char first[5];
+  char second[4];
+  std::array<std::span<char>, 2> in{std::span<char>(first), std::span<char>(second)};
+  auto [recv_status, received] = libcoro::sync(right.recvv(in));
+  EXPECT_EQ(recv_status, libcoro::socket::TransferStatus::OK);
+  EXPECT_EQ(received, sent);
+  EXPECT_EQ(std::string_view(first, 5), header);
+  EXPECT_EQ(std::string_view(second, 4), body);
+
+  left.close();
+  right.close();
+  io_service->close();
+}
+
+TEST(IOServiceTest, BatchedDatagrams) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_DGRAM, 0, fds), 0);
+  libcoro::Socket<executor_type> left{io_service, fds[0]};
+  libcoro::Socket<executor_type> right{io_service, fds[1]};
+
+  std::array<std::span<const char>, 3> datagrams{std::string_view("a"), std::string_view("bb"),
+                                                 std::string_view("ccc")};
+  auto [send_status, sent] = libcoro::sync(left.send_many(datagrams));
+  EXPECT_EQ(send_status, libcoro::socket::TransferStatus::OK);
+  EXPECT_EQ(sent, 3u);
+
+  std::array<std::array<char, 8>, 4> storage{};
+  std::array<std::span<char>, 4> buffers{storage[0], storage[1], storage[2], storage[3]};
+  std::array<std::size_t, 4> sizes{};
+  auto [recv_status, received] = libcoro::sync(right.recv_many(buffers, sizes));
+  EXPECT_EQ(recv_status, libcoro::socket::TransferStatus::OK);
+  ASSERT_EQ(received, 3u);
+  EXPECT_EQ(std::string_view(storage[1].data(), sizes[1]), "bb");
+  EXPECT_EQ(std::string_view(storage[2].data(), sizes[2]), "ccc");
+
+  left.close();
+  right.close();
+  io_service->close();
+}
+
+#ifdef __linux__
+TEST(IOServiceTest, ZerocopySendResumesOnRelease) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_NE(listener, -1);
+  struct sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_len = sizeof(addr);
+  ASSERT_EQ(::bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+  ASSERT_EQ(::listen(listener, 1), 0);
+  ASSERT_EQ(::getsockname(listener, reinterpret_cast<struct sockaddr*>(&addr), &addr_len), 0);
+
+  int client = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_EQ(::connect(client, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+  int server = ::accept(listener, nullptr, nullptr);
+  ASSERT_NE(server, -1);
+
+  libcoro::Socket<executor_type> sender{io_service, client};
+  if (!sender.enable_zerocopy()) {
+    ::close(server);
+    ::close(listener);
+    sender.close();
+    io_service->close();
+    GTEST_SKIP() << "SO_ZEROCOPY is not supported";
+  }
+
+  // on loopback the buffer is released once the receiver has consumed it.
+  std::size_t received = 0;
+  std::thread reader([&]() {
+    char buffer[4096];
+    ssize_t bytes = 0;
+    while ((bytes = ::read(server, buffer, sizeof(buffer))) > 0) {
+      received += static_cast<std::size_t>(bytes);
+    }
+  });
+
+  std::string payload(256 * 1024, 'z');
+  auto [status, sent] = libcoro::sync(sender.send_zerocopy(payload));
+  EXPECT_EQ(status, libcoro::socket::TransferStatus::OK);
+  EXPECT_GT(sent, 0u);
+
+  sender.close();
+  reader.join();
+  EXPECT_EQ(received, sent);
+
+  ::close(server);
+  ::close(listener);
+  io_service->close();
+}
+#endif
+
+TEST(IOServiceTest, TransferFileToSocket) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  std::string content(100000, 'f');
+  content.replace(0, 5, "start");
+  auto* stream = std::tmpfile();
+  ASSERT_NE(stream, nullptr);
+  ASSERT_EQ(std::fwrite(content.data(), 1, content.size(), stream), content.size());
+  ASSERT_EQ(std::fflush(stream), 0);
+  libcoro::File<executor_type> file{io_service, ::dup(::fileno(stream))};
+  std::fclose(stream);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  libcoro::Socket<executor_type> sender{io_service, fds[0]};
+
+  // the socket buffer is smaller than the file, so the transfer has to wait for the reader.
+  std::string received;
+  std::thread reader([&]() {
+    char buffer[4096];
+    ssize_t bytes = 0;
+    while ((bytes = ::read(fds[1], buffer, sizeof(buffer))) > 0) {
+      received.append(buffer, static_cast<std::size_t>(bytes));
+    }
+  });
+
+  auto [status, sent] = libcoro::sync(libcoro::transfer(file, sender, 0, content.size()));
+  EXPECT_EQ(status, libcoro::socket::TransferStatus::OK);
+  EXPECT_EQ(sent, content.size());
+
+  sender.close();
+  reader.join();
+  EXPECT_EQ(received, content);
+
+  ::close(fds[1]);
+  file.close();
+  io_service->close();
+}
+
+TEST(IOServiceTest, SendToClosedPeerFailsWithoutSigpipe) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  auto* stream = std::tmpfile();
+  ASSERT_NE(stream, nullptr);
+  ASSERT_EQ(std::fwrite("payload", 1, 7, stream), 7u);
+  ASSERT_EQ(std::fflush(stream), 0);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  libcoro::Socket<executor_type> sender{io_service, fds[0]};
+  ::close(fds[1]);
+
+  // SIGPIPE is left at its default action, raising it would kill the test.
+  constexpr std::string_view message = "payload";
+  EXPECT_EQ(libcoro::sync(sender.send(message)).first,
+            libcoro::socket::TransferStatus::PIPE_ERROR);
+  EXPECT_EQ(sender.send_sync(message).first, libcoro::socket::TransferStatus::PIPE_ERROR);
+  EXPECT_EQ(libcoro::sync(sender.send_file(::fileno(stream), 0, 7)).first,
+            libcoro::socket::TransferStatus::PIPE_ERROR);
+
+  std::fclose(stream);
+  sender.close();
+  io_service->close();
+}
+
+TEST(IOServiceTest, AcceptDrainsBacklog) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+  auto other_executor = std::make_shared<executor_type>();
+  auto other_io_service = std::make_shared<libcoro::IOService<executor_type>>(other_executor);
+
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  ASSERT_NE(fd, -1);
+  struct sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_len = sizeof(addr);
+  ASSERT_EQ(::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+  ASSERT_EQ(::listen(fd, 16), 0);
+  ASSERT_EQ(::getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len), 0);
+  libcoro::Socket<executor_type> listener{io_service, fd};
+
+  constexpr std::size_t CLIENTS = 8;
+  std::vector<int> clients;
+  for (std::size_t i = 0; i < CLIENTS; ++i) {
+    int client = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_EQ(::connect(client, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+    clients.push_back(client);
+  }
+
+  auto accept_clients = [&]() -> libcoro::Task<std::size_t> {
+    auto first = co_await listener.accept();
+    first.close();
+
+    std::size_t accepted = 1;
+    auto connections =
+        listener.accept_all(std::vector<io_service_ptr>{io_service, other_io_service});
+    while (accepted < CLIENTS) {
+      auto connection = co_await connections.next();
+      if (!connection) {
+        break;
+      }
+      connection->close();
+      ++accepted;
+    }
+    co_return accepted;
+  };
+  EXPECT_EQ(libcoro::sync(accept_clients()), CLIENTS);
+
+  for (auto client : clients) {
+    ::close(client);
+  }
+  listener.close();
+  other_io_service->close();
+  io_service->close();
+}
+
+TEST(IOServiceTest, ClosingTheListenerEndsAcceptAll) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  ASSERT_NE(fd, -1);
+  struct sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+  ASSERT_EQ(::listen(fd, 16), 0);
+  libcoro::Socket<executor_type> listener{io_service, fd};
+
+  std::promise<bool> ended;
+  auto accept_clients = [&]() -> libcoro::Task<void> {
+    auto connections = listener.accept_all();
+    // nobody connects, the generator parks until the listener goes away.
+    auto connection = co_await connections.next();
+    ended.set_value(!connection.has_value());
+  };
+  io_service->execute(accept_clients());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  auto close = [&]() -> libcoro::Task<void> {
+    listener.close();
+    co_return;
+  };
+  io_service->execute(close());
+
+  auto result = ended.get_future();
+  ASSERT_EQ(result.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  EXPECT_TRUE(result.get());
+  io_service->close();
+}
+
+TEST(IOServiceTest, SendAllLoopsOverPartialWrites) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  libcoro::Socket<executor_type> left{io_service, fds[0]};
+  libcoro::Socket<executor_type> right{io_service, fds[1]};
+
+  // far more than the socket buffer holds, send_all has to wait for the reader repeatedly.
+  std::string payload(1024 * 1024, 'a');
+  for (std::size_t i = 0; i < payload.size(); i += 4096) {
+    payload[i] = static_cast<char>('a' + (i / 4096) % 26);
+  }
+
+  std::string received;
+  std::thread reader([&]() {
+    std::array<char, 16384> buffer;
+    while (received.size() < payload.size()) {
+      auto [status, bytes] = libcoro::sync(right.recieve(buffer));
+      if (status != libcoro::socket::TransferStatus::OK) {
+        break;
+      }
+      received.append(buffer.data(), bytes);
+    }
+  });
+
+  auto [status, sent] = libcoro::sync(left.send_all(payload));
+  EXPECT_EQ(status, libcoro::socket::TransferStatus::OK);
+  EXPECT_EQ(sent, payload.size());
+  reader.join();
+  EXPECT_EQ(received, payload);
+
+  left.close();
+  right.close();
+  io_service->close();
+}
+
+TEST(IOServiceTest, CoalescedSendsArriveInOrder) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  // every send syscall is one record here, so the receiver sees how many writes were made.
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+  libcoro::Socket<executor_type> left{io_service, fds[0]};
+  libcoro::Socket<executor_type> right{io_service, fds[1]};
+  left.enable_coalescing();
+
+  std::size_t records = 0;
+  auto exchange = [&]() -> libcoro::Task<std::string> {
+    // sends are only held back until the turn ends on the executor.
+    co_await io_service->schedule();
+    std::string expected;
+    for (int i = 0; i < 100; ++i) {
+      auto part = std::to_string(i) + ";";
+      expected += part;
+      auto [status, sent] = co_await left.send(part);
+      EXPECT_EQ(status, libcoro::socket::TransferStatus::OK);
+      EXPECT_EQ(sent, part.size());
+    }
+
+    std::string received;
+    std::array<char, 1024> buffer;
+    while (received.size() < expected.size()) {
+      auto [status, bytes] = co_await right.recieve(buffer);
+      if (status != libcoro::socket::TransferStatus::OK) {
+        break;
+      }
+      received.append(buffer.data(), bytes);
+      ++records;
+    }
+    EXPECT_EQ(received, expected);
+    co_return received;
+  };
+  EXPECT_FALSE(libcoro::sync(exchange()).empty());
+  // all of the turn's sends went out with a single write.
+  EXPECT_EQ(records, 1u);
+
+  left.close();
+  right.close();
+  io_service->close();
+}
+
+TEST(IOServiceTest, SocketOptionsApplyAtCreationAndAccept) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  libcoro::socket::Options client_options{};
+  client_options.no_delay = true;
+  client_options.send_buffer = 32 * 1024;
+  auto client = libcoro::create_socket(io_service, libcoro::socket::Family::IPV4,
+                                       libcoro::socket::Protocol::TCP, client_options);
+
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  ASSERT_NE(fd, -1);
+  libcoro::Socket<executor_type> listener{io_service, fd};
+  libcoro::socket::Options listener_options{};
+  listener_options.reuse_address = true;
+  listener_options.receive_buffer = 64 * 1024;
+  ASSERT_EQ(listener.set_options(listener_options), 0);
+
+  int receive_buffer = 0;
+  socklen_t length = sizeof(receive_buffer);
+  ASSERT_EQ(::getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, &length), 0);
+  EXPECT_GE(receive_buffer, 64 * 1024);
+
+  struct sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_len = sizeof(addr);
+  ASSERT_EQ(::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+  ASSERT_EQ(listener.listen(), 0);
+  ASSERT_EQ(::getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len), 0);
+
+  libcoro::socket::Options accept_options{};
+  accept_options.no_delay = true;
+  listener.set_accept_options(accept_options);
+
+  int peer = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_EQ(::connect(peer, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+  auto accepted = libcoro::sync(listener.accept());
+  accepted.close();
+
+  ::close(peer);
+  client.close();
+  listener.close();
+  io_service->close();
+}
+
+TEST(IOServiceTest, OffloadGrowsThePoolAndResumesOnTheExecutor) {
+  auto executor = std::make_shared<executor_type>();
+  auto io_service = std::make_shared<libcoro::IOService<executor_type>>(executor);
+
+  auto executor_thread = libcoro::sync([&]() -> libcoro::Task<std::thread::id> {
+    co_await io_service->schedule();
+    co_return std::this_thread::get_id();
+  }());
+
+  // every call blocks until all of them run at once, which needs a thread each.
+  constexpr int calls = 4;
+  std::atomic<int> running{0};
+  std::atomic<int> resumed_on_executor{0};
+  std::latch done{calls};
+  auto call = [&]() -> libcoro::Task<void> {
+    auto all_running = co_await io_service->offload([&]() {
+      running.fetch_add(1);
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+      while (running.load() < calls && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      return running.load() == calls;
+    });
+    EXPECT_TRUE(all_running);
+    if (std::this_thread::get_id() == executor_thread) {
+      resumed_on_executor.fetch_add(1);
+    }
+    done.count_down();
+  };
+  for (int i = 0; i < calls; ++i) {
+    io_service->execute(call());
+  }
+  done.wait();
+  EXPECT_EQ(resumed_on_executor.load(), calls);
+  EXPECT_GE(io_service->blocking_pool().threads(), static_cast<std::size_t>(calls));
+
+  bool ran = false;
+  libcoro::sync(io_service->offload([&]() { ran = true; }));
+  EXPECT_TRUE(ran);
+  EXPECT_THROW(libcoro::sync(io_service->offload([]() -> int {
+                 throw std::runtime_error("failed");
+               })),
+               std::runtime_error);
+
+  io_service->close();
+}
@@ -0,0 +1,187 @@
+#include "concepts/executor.hpp"
+#include "libcoro/multi_thread_executor.hpp"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <gtest/gtest.h>
+#include <latch>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+Detached run_on(libcoro::MultiThreadExecutor& executor, std::atomic<int>& counter,
+                std::latch& done) {
+  co_await executor.start();
+  counter.fetch_add(1, std::memory_order_relaxed);
+  done.count_down();
+}
+
+Detached fan_out(libcoro::MultiThreadExecutor& executor, std::atomic<int>& counter,
+                 std::latch& done, int children) {
+  co_await executor.start();
+  // spawned from inside a worker, so these land on the local queue and get stolen.
+  for (int i = 0; i < children; ++i) {
+    run_on(executor, counter, done);
+  }
+  done.count_down();
+}
+// suspends and leaves the handle for the test to resume.
+struct Park {
+  std::vector<std::coroutine_handle<>>& handles;
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle) { handles.push_back(handle); }
+  void await_resume() const noexcept {}
+};
+
+Detached parked(std::vector<std::coroutine_handle<>>& handles, std::atomic<int>& counter,
+                std::latch& done) {
+  co_await Park{handles};
+  counter.fetch_add(1, std::memory_order_relaxed);
+  done.count_down();
+}
+// two coroutines that only ever wake each other, from a worker, so each lands in the `next` slot.
+struct PingPong {
+  libcoro::MultiThreadExecutor& executor;
+  std::atomic<bool> stop{false};
+  std::atomic<int> rounds{0};
+  // touched on the single worker only.
+  std::coroutine_handle<> parked{nullptr};
+};
+
+// parks the caller and wakes the coroutine parked before it.
+struct Handoff {
+  PingPong& state;
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    if (auto peer = std::exchange(state.parked, handle)) {
+      state.executor.resume(peer);
+    }
+  }
+  void await_resume() const noexcept {}
+};
+
+Detached ping_pong(PingPong& state, std::latch& done) {
+  co_await state.executor.start();
+  while (!state.stop.load(std::memory_order_relaxed)) {
+    co_await Handoff{state};
+    state.rounds.fetch_add(1, std::memory_order_relaxed);
+  }
+  // the peer is parked, it has to see the stop as well.
+  if (auto peer = std::exchange(state.parked, nullptr)) {
+    state.executor.resume(peer);
+  }
+  done.count_down();
+}
+
+// reschedules itself from the worker, which pushes whatever held the `next` slot to the local
+// queue, so the local queue never runs dry.
+Detached yielder(PingPong& state, std::latch& done) {
+  co_await state.executor.start();
+  while (!state.stop.load(std::memory_order_relaxed)) {
+    co_await state.executor.start();
+  }
+  done.count_down();
+}
+} // namespace
+
+static_assert(libcoro::concepts::batch_executor<libcoro::MultiThreadExecutor>);
+
+TEST(MultiThreadExecutorTest, RunsExternalSubmissions) {
+  constexpr int count = 10000;
+  std::atomic<int> counter{0};
+  std::latch done{count};
+  {
+    libcoro::MultiThreadExecutor executor{4};
+    for (int i = 0; i < count; ++i) {
+      run_on(executor, counter, done);
+    }
+    done.wait();
+  }
+  EXPECT_EQ(counter.load(), count);
+}
+
+TEST(MultiThreadExecutorTest, RunsWorkerSubmissions) {
+  constexpr int parents = 100;
+  constexpr int children = 100;
+  std::atomic<int> counter{0};
+  std::latch done{parents * (children + 1)};
+  {
+    libcoro::MultiThreadExecutor executor{4};
+    for (int i = 0; i < parents; ++i) {
+      fan_out(executor, counter, done, children);
+    }
+    done.wait();
+  }
+  EXPECT_EQ(counter.load(), parents * children);
+}
+
+TEST(MultiThreadExecutorTest, ShutdownWithoutWork) {
+  libcoro::MultiThreadExecutor executor{2};
+  executor.shutdown();
+  EXPECT_THROW(executor.start(), std::runtime_error);
+}
+
+TEST(MultiThreadExecutorTest, ResumesBatches) {
+  constexpr int count = 1000;
+  std::atomic<int> counter{0};
+  std::latch done{count};
+  std::vector<std::coroutine_handle<>> handles;
+  for (int i = 0; i < count; ++i) {
+    parked(handles, counter, done);
+  }
+  {
+    libcoro::MultiThreadExecutor executor{4};
+    executor.resume_batch(handles);
+    done.wait();
+  }
+  EXPECT_EQ(counter.load(), count);
+}
+
+TEST(MultiThreadExecutorTest, PingPongDoesNotStarveOtherWork) {
+  // one worker, so nothing is stolen: the pair keeps the `next` slot busy and the yielder the local
+  // queue, everything else only runs because MAX_NEXT_RUNS and GLOBAL_POLL_INTERVAL bound them.
+  constexpr int external = 100;
+  constexpr int children = 100;
+  std::atomic<int> counter{0};
+  std::latch done{external + children + 1};
+  std::latch busy_done{3};
+  libcoro::MultiThreadExecutor executor{1};
+  PingPong state{executor};
+
+  ping_pong(state, busy_done);
+  ping_pong(state, busy_done);
+  yielder(state, busy_done);
+  while (state.rounds.load() == 0) {
+    std::this_thread::yield();
+  }
+
+  // the global queue, and children spawned on the worker into the local queue.
+  for (int i = 0; i < external; ++i) {
+    run_on(executor, counter, done);
+  }
+  fan_out(executor, counter, done, children);
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (counter.load() < external + children && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(counter.load(), external + children);
+  auto rounds = state.rounds.load();
+
+  state.stop.store(true);
+  busy_done.wait();
+  done.wait();
+  // the pair kept going the whole time.
+  EXPECT_GT(rounds, external + children);
+}
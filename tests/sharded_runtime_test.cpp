@@ -0,0 +1,46 @@
+#include "libcoro/sharded_runtime.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <latch>
+
+namespace {
+libcoro::Task<void> record(std::atomic<int>& counter, std::latch& done) {
+  counter.fetch_add(1, std::memory_order_relaxed);
+  done.count_down();
+  co_return;
+}
+} // namespace
+
+TEST(ShardedRuntimeTest, SpawnsOnEveryShard) {
+  constexpr std::size_t shards = 2;
+  std::atomic<int> counter{0};
+  std::latch done{shards};
+
+  libcoro::ShardedRuntime runtime{shards};
+  for (std::size_t i = 0; i < runtime.size(); ++i) {
+    runtime.spawn(i, record(counter, done));
+  }
+  done.wait();
+  runtime.close();
+
+  EXPECT_EQ(counter.load(), static_cast<int>(shards));
+}
+
+TEST(ShardedRuntimeTest, ListenerPerShard) {
+  libcoro::ShardedRuntime runtime{2, false};
+  auto address =
+      libcoro::socket::IPAddress::from_string("127.0.0.1", libcoro::socket::Family::IPV4);
+  auto listeners = libcoro::create_listener(runtime, libcoro::socket::Family::IPV4,
+                                            libcoro::socket::Protocol::TCP, address, 0);
+  EXPECT_EQ(listeners.size(), runtime.size());
+
+  // every shard listens on the one port the kernel picked, read back with getsockname.
+  auto port = listeners.front().local_port();
+  EXPECT_GT(port, 0);
+  for (auto& listener : listeners) {
+    EXPECT_EQ(listener.local_port(), port);
+  }
+  for (auto& listener : listeners) {
+    listener.close();
+  }
+}
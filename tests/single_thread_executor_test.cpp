@@ -0,0 +1,52 @@
+#include "concepts/executor.hpp"
+#include "libcoro/single_thread_executor.hpp"
+#include <atomic>
+#include <coroutine>
+#include <gtest/gtest.h>
+#include <latch>
+#include <thread>
+#include <vector>
+
+namespace {
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+Detached run_on(libcoro::SingleThreadExecutor& executor, std::atomic<int>& counter,
+                std::latch& done) {
+  co_await executor.start();
+  counter.fetch_add(1, std::memory_order_relaxed);
+  done.count_down();
+}
+} // namespace
+
+static_assert(libcoro::concepts::batch_executor<libcoro::SingleThreadExecutor>);
+
+TEST(SingleThreadExecutorTest, NoHandleIsLost) {
+  constexpr int producers = 4;
+  constexpr int count = 5000;
+  std::atomic<int> counter{0};
+  std::latch done{producers * count};
+  {
+    libcoro::SingleThreadExecutor executor{};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i) {
+      threads.emplace_back([&] {
+        for (int j = 0; j < count; ++j) {
+          run_on(executor, counter, done);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    done.wait();
+  }
+  EXPECT_EQ(counter.load(), producers * count);
+}
@@ -0,0 +1,92 @@
+#include "libcoro/timer_wheel.hpp"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+using clock_type = libcoro::detail::TimerWheel::clock;
+using namespace std::chrono_literals;
+
+struct TestTimer : libcoro::detail::TimerNode {
+  int id{0};
+};
+} // namespace
+
+TEST(TimerWheelTest, ExpiresInDeadlineOrder) {
+  auto origin = clock_type::now();
+  libcoro::detail::TimerWheel wheel{origin};
+
+  // spread over every level, including one that has to cascade three times.
+  std::vector<TestTimer> timers(4);
+  std::vector<std::chrono::milliseconds> delays{70000ms, 5ms, 300ms, 20000000ms};
+  for (int i = 0; i < 4; ++i) {
+    timers[i].id = i;
+    wheel.add(timers[i], origin + delays[i]);
+  }
+  EXPECT_EQ(wheel.size(), 4u);
+
+  std::vector<std::pair<int, clock_type::time_point>> fired;
+  auto now = origin;
+  while (!wheel.empty()) {
+    auto expiry = wheel.next_expiry();
+    ASSERT_TRUE(expiry.has_value());
+    ASSERT_GT(*expiry, now);
+    now = *expiry;
+    wheel.advance(now, [&](libcoro::detail::TimerNode& node) {
+      fired.emplace_back(static_cast<TestTimer&>(node).id, now);
+    });
+  }
+
+  ASSERT_EQ(fired.size(), 4u);
+  std::vector<int> order{1, 2, 0, 3};
+  for (std::size_t i = 0; i < fired.size(); ++i) {
+    EXPECT_EQ(fired[i].first, order[i]);
+    EXPECT_EQ(fired[i].second, origin + delays[order[i]]);
+  }
+}
+
+TEST(TimerWheelTest, CancelledTimersDoNotFire) {
+  auto origin = clock_type::now();
+  libcoro::detail::TimerWheel wheel{origin};
+
+  TestTimer kept{};
+  TestTimer cancelled{};
+  wheel.add(kept, origin + 10ms);
+  wheel.add(cancelled, origin + 10ms);
+  wheel.cancel(cancelled);
+  EXPECT_FALSE(cancelled.linked());
+  EXPECT_EQ(wheel.size(), 1u);
+
+  std::size_t count = 0;
+  wheel.advance(origin + 1s, [&](libcoro::detail::TimerNode& node) {
+    EXPECT_EQ(&node, &kept);
+    ++count;
+  });
+  EXPECT_EQ(count, 1u);
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_FALSE(wheel.next_expiry().has_value());
+}
+
+TEST(TimerWheelTest, FarTimersDoNotWakeEveryRotation) {
+  auto origin = clock_type::now();
+  libcoro::detail::TimerWheel wheel{origin};
+
+  TestTimer timer{};
+  wheel.add(timer, origin + 70000ms);
+
+  // one wakeup per level the timer cascades through, not one every 256 ticks.
+  std::size_t wakeups = 0;
+  std::size_t fired = 0;
+  auto now = origin;
+  while (!wheel.empty()) {
+    auto expiry = wheel.next_expiry();
+    ASSERT_TRUE(expiry.has_value());
+    ASSERT_GT(*expiry, now);
+    now = *expiry;
+    ++wakeups;
+    fired += wheel.advance(now, [](libcoro::detail::TimerNode&) {});
+  }
+  EXPECT_EQ(fired, 1u);
+  EXPECT_EQ(now, origin + 70000ms);
+  EXPECT_LE(wakeups, libcoro::detail::TimerWheel::LEVELS);
+}